@@ -0,0 +1,52 @@
+// Cost of AsyncLogger::log() for a producer thread, with and without a style,
+// and the CPU time the background thread takes while the logger is idle.
+
+#include "../dye.hpp"
+#include <chrono>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+
+namespace {
+	const size_t RECORDS = 100000;
+	const size_t RUNS = 10;
+	// Holds the records of a run, so that none is dropped
+	const size_t RING_CAPACITY = 16 << 20;
+
+	const dye::ColorManipulator warning = ~dye::yellow;
+
+	// After a first run, which faults the ring in
+	template <typename F>
+	void report(const char* name, dye::AsyncLogger& log, F record) {
+		for (size_t i=0; i<RECORDS; ++i) record();
+		while (log.queue_depth() != 0) std::this_thread::yield();
+		double nanoseconds = 0;
+		for (size_t run=0; run<RUNS; ++run) {
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (size_t i=0; i<RECORDS; ++i) record();
+			nanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			// Lets the background thread catch up between runs
+			while (log.queue_depth() != 0) std::this_thread::yield();
+		}
+		std::cout << name << ": " << std::fixed << std::setprecision(1)
+		          << nanoseconds / (RECORDS * RUNS) << " ns/record\n";
+	}
+}
+
+int main() {
+	const int fd = open("/dev/null", O_WRONLY);
+	{
+		dye::AsyncLogger log(fd, dye::ALWAYS_COLOR, RING_CAPACITY);
+		const std::string text = "request 1234 served in 56 ms\n";
+		report("log(text)         ", log, [&]() { log.log(text); });
+		report("log(&style, text) ", log, [&]() { log.log(&warning, text); });
+		if (log.dropped() != 0) std::cout << log.dropped() << " records dropped\n";
+
+		const std::clock_t start = std::clock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		std::cout << "idle for 500 ms   : " << std::fixed << std::setprecision(1)
+		          << 1000.0 * (std::clock() - start) / CLOCKS_PER_SEC << " ms of CPU\n";
+	}
+	close(fd);
+	return 0;
+}
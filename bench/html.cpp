@@ -0,0 +1,60 @@
+// Throughput of converting 64 MiB of clean text to HTML, then of text colored
+// every 80 bytes: with HtmlConverter, whose callback only counts the HTML
+// bytes, and with html() into a std::string, for both stylings.
+
+#include "../dye.hpp"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+	const size_t SIZE = 64 << 20;
+	const size_t RUNS = 5;
+
+	// After a first run, which allocates the output
+	template <typename F>
+	void report(const char* name, size_t size, F convert) {
+		convert();
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i=0; i<RUNS; ++i) convert();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << name << ": " << std::fixed << std::setprecision(2)
+		          << size * RUNS / seconds / 1e6 << " MB/s\n";
+	}
+
+	void bench(const char* input_name, const std::string& input) {
+		size_t written = 0;
+		std::string out;
+		std::cout << input_name << ":\n";
+		report("  HtmlConverter, inline styles", input.size(), [&]() {
+			dye::HtmlConverter converter(dye::INLINE_STYLES);
+			converter.feed(input.data(), input.size(), [&written](const char*, size_t size) { written += size; });
+			converter.finish([&written](const char*, size_t size) { written += size; });
+		});
+		report("  HtmlConverter, CSS classes  ", input.size(), [&]() {
+			dye::HtmlConverter converter(dye::CSS_CLASSES);
+			converter.feed(input.data(), input.size(), [&written](const char*, size_t size) { written += size; });
+			converter.finish([&written](const char*, size_t size) { written += size; });
+		});
+		report("  html(), inline styles       ", input.size(), [&]() {
+			out = dye::html(input);
+		});
+		// Keeps the conversion from being optimized away
+		if (written == 0 || out.empty()) std::cout << "nothing written\n";
+	}
+}
+
+int main() {
+	std::string clean;
+	clean.reserve(SIZE);
+	while (clean.size() < SIZE) clean += "The quick brown fox jumps over the lazy dog, 0123456789.\n";
+
+	std::ostringstream colored;
+	colored << dye::always_color;
+	for (size_t i=0; size_t(colored.tellp()) < SIZE; ++i)
+		colored << dye::rgb256(i % 256)("The quick brown fox jumps over the lazy dog.") << " " << i << "\n";
+
+	bench("Clean text", clean);
+	bench("Colored text", colored.str());
+	return 0;
+}
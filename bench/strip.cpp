@@ -0,0 +1,56 @@
+// Throughput of stripping 64 MiB of clean text, then of text colored every
+// 80 bytes: with Stripper, whose callback only counts the kept bytes, and
+// with strip() into a std::string.
+
+#include "../dye.hpp"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+	const size_t SIZE = 64 << 20;
+	const size_t RUNS = 10;
+
+	// After a first run, which allocates the output
+	template <typename F>
+	void report(const char* name, size_t size, F strip) {
+		strip();
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i=0; i<RUNS; ++i) strip();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << name << ": " << std::fixed << std::setprecision(2)
+		          << size * RUNS / seconds / 1e9 << " GB/s\n";
+	}
+
+	void bench(const char* input_name, const std::string& input) {
+		size_t kept = 0;
+		std::string out;
+		std::cout << input_name << ":\n";
+		report("  Stripper", input.size(), [&]() {
+			dye::Stripper stripper;
+			stripper.feed(input.data(), input.size(), [&kept](const char*, size_t size) { kept += size; });
+			stripper.finish([&kept](const char*, size_t size) { kept += size; });
+		});
+		report("  strip() ", input.size(), [&]() {
+			out.clear();
+			dye::strip(out, input.data(), input.size());
+		});
+		// Keeps the stripping from being optimized away
+		if (kept == 0 || out.empty()) std::cout << "nothing kept\n";
+	}
+}
+
+int main() {
+	std::string clean;
+	clean.reserve(SIZE);
+	while (clean.size() < SIZE) clean += "The quick brown fox jumps over the lazy dog, 0123456789.\n";
+
+	std::ostringstream colored;
+	colored << dye::always_color;
+	for (size_t i=0; size_t(colored.tellp()) < SIZE; ++i)
+		colored << dye::rgb256(i % 256)("The quick brown fox jumps over the lazy dog.") << " " << i << "\n";
+
+	bench("Clean text", clean);
+	bench("Colored text", colored.str());
+	return 0;
+}
@@ -0,0 +1,42 @@
+// Throughput of RGB to xterm256 conversion: one ECMA48_from_rgb() call per
+// pixel, and ECMA48_from_rgb_pixels() on a 1920x1080 frame of random pixels.
+
+#include "../dye.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+	const size_t PIXELS = 1920 * 1080;
+	const size_t FRAMES = 20;
+
+	template <typename F>
+	void report(const char* name, F convert) {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i=0; i<FRAMES; ++i) convert();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << name << ": " << std::fixed << std::setprecision(1)
+		          << PIXELS * FRAMES / seconds / 1e6 << " Mpx/s\n";
+	}
+}
+
+int main() {
+	std::vector<uint8_t> rgb(3 * PIXELS);
+	std::mt19937 random(1);
+	for (size_t i=0; i<rgb.size(); ++i) rgb[i] = uint8_t(random());
+	std::vector<uint8_t> indices(PIXELS);
+
+	report("ECMA48_from_rgb        ", [&]() {
+		for (size_t i=0; i<PIXELS; ++i)
+			indices[i] = uint8_t(dye::xterm256::ECMA48_from_rgb(rgb[3*i], rgb[3*i+1], rgb[3*i+2]));
+	});
+	report("ECMA48_from_rgb_pixels ", [&]() {
+		dye::xterm256::ECMA48_from_rgb_pixels(rgb.data(), PIXELS, indices.data());
+	});
+
+	// Keeps the conversions from being optimized away
+	size_t checksum = 0;
+	for (size_t i=0; i<PIXELS; ++i) checksum += indices[i];
+	return checksum == 0;
+}
@@ -10,22 +10,217 @@
 
 // Standard library
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <vector>
 // POSIX
+#include <sys/uio.h>
 #include <unistd.h>
+// SIMD
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // The ECMA48 standard is available in PDF form at:
 // http://www.ecma-international.org/publications/files/ECMA-ST/Ecma-048.pdf
 // Control functions are specified in §5. Their meaning and representation are
 // described in §8.3, pp. 33-74.
 
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                  Sequences                                 //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	namespace ECMA48 {
+		// Non-owning reference to bytes with static storage duration
+		class SequenceView {
+			public:
+				constexpr SequenceView()
+					: data_("")
+					, size_(0)
+					{}
+
+				constexpr SequenceView(const char* data, size_t size)
+					: data_(data)
+					, size_(size)
+					{}
+
+				template <size_t N>
+				constexpr SequenceView(const char (&literal)[N])
+					: data_(literal)
+					, size_(N - 1)
+					{}
+
+				// Accessors
+
+				constexpr const char* data() const { return data_; }
+				constexpr size_t size() const { return size_; }
+				constexpr bool empty() const { return size_ == 0; }
+				constexpr char operator[](size_t i) const { return data_[i]; }
+
+				const char* begin() const { return data_; }
+				const char* end() const { return data_ + size_; }
+
+				// Conversions
+
+				std::string str() const { return std::string(data_, size_); }
+				operator std::string() const { return str(); }
+
+			private:
+				const char* data_;
+				size_t      size_;
+		};
+
+		inline std::ostream& operator<<(std::ostream& stream, const SequenceView& sequence) {
+			return stream.write(sequence.data(), sequence.size());
+		}
+
+		// String operations, for compatibility with code treating control functions
+		// as std::strings
+
+		inline std::string operator+(const SequenceView& a, const SequenceView& b) {
+			return a.str().append(b.data(), b.size());
+		}
+
+		inline std::string operator+(const SequenceView& a, const std::string& b) {
+			return a.str() + b;
+		}
+
+		inline std::string operator+(const std::string& a, const SequenceView& b) {
+			return std::string(a).append(b.data(), b.size());
+		}
+
+		inline std::string operator+(const SequenceView& a, const char* b) {
+			return a.str() + b;
+		}
+
+		inline std::string operator+(const char* a, const SequenceView& b) {
+			return std::string(a).append(b.data(), b.size());
+		}
+
+		inline bool operator==(const SequenceView& a, const SequenceView& b) {
+			return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+		}
+
+		inline bool operator==(const SequenceView& a, const std::string& b) {
+			return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+		}
+
+		inline bool operator==(const std::string& a, const SequenceView& b) {
+			return b == a;
+		}
+
+		inline bool operator!=(const SequenceView& a, const SequenceView& b) { return !(a == b); }
+		inline bool operator!=(const SequenceView& a, const std::string& b) { return !(a == b); }
+		inline bool operator!=(const std::string& a, const SequenceView& b) { return !(a == b); }
+
+		// ·······························
+		// Fixed-capacity sequence storage
+
+		namespace detail {
+			template <size_t... I>
+			struct Indices {};
+
+			template <size_t N, size_t... I>
+			struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+			template <size_t... I>
+			struct MakeIndices<0, I...> {
+				typedef Indices<I...> type;
+			};
+		}
+
+		// Sequence of at most CAPACITY bytes stored inline, without allocation.
+		// Buffers can be filled in constant expressions from any SOURCE providing
+		// constexpr size() and operator[].
+		template <size_t CAPACITY>
+		class SequenceBuffer {
+			public:
+				constexpr SequenceBuffer()
+					: bytes_()
+					, size_(0)
+					{}
+
+				template <typename SOURCE>
+				constexpr explicit SequenceBuffer(const SOURCE& source)
+					: SequenceBuffer(source, typename detail::MakeIndices<CAPACITY>::type())
+					{}
+
+				SequenceBuffer(const char* data, size_t size)
+					: size_(size) {
+					assert(size <= CAPACITY);
+					std::memcpy(bytes_, data, size);
+				}
+
+				// Accessors
+
+				constexpr const char* data() const { return bytes_; }
+				constexpr size_t size() const { return size_; }
+				constexpr bool empty() const { return size_ == 0; }
+				constexpr char operator[](size_t i) const { return bytes_[i]; }
+
+				const char* begin() const { return bytes_; }
+				const char* end() const { return bytes_ + size_; }
+
+				// Conversions
+
+				constexpr SequenceView view() const { return SequenceView(bytes_, size_); }
+				constexpr operator SequenceView() const { return view(); }
+				std::string str() const { return std::string(bytes_, size_); }
+				operator std::string() const { return str(); }
+
+			private:
+				template <typename SOURCE, size_t... I>
+				constexpr SequenceBuffer(const SOURCE& source, detail::Indices<I...>)
+					: bytes_{(I < source.size() ? source[I] : '\0')...}
+					, size_((assert(source.size() <= CAPACITY), source.size()))
+					{}
+
+				char          bytes_[CAPACITY];
+				unsigned char size_;
+		};
+
+		template <size_t CAPACITY>
+		inline std::ostream& operator<<(std::ostream& stream, const SequenceBuffer<CAPACITY>& sequence) {
+			return stream.write(sequence.data(), sequence.size());
+		}
+
+		template <size_t CAPACITY>
+		inline bool operator==(const SequenceBuffer<CAPACITY>& a, const SequenceView& b) { return a.view() == b; }
+		template <size_t CAPACITY>
+		inline bool operator==(const SequenceView& a, const SequenceBuffer<CAPACITY>& b) { return a == b.view(); }
+		template <size_t CAPACITY>
+		inline bool operator==(const SequenceBuffer<CAPACITY>& a, const std::string& b) { return a.view() == b; }
+		template <size_t CAPACITY>
+		inline bool operator==(const std::string& a, const SequenceBuffer<CAPACITY>& b) { return a == b.view(); }
+
+		template <size_t CAPACITY>
+		inline bool operator!=(const SequenceBuffer<CAPACITY>& a, const SequenceView& b) { return !(a == b); }
+		template <size_t CAPACITY>
+		inline bool operator!=(const SequenceView& a, const SequenceBuffer<CAPACITY>& b) { return !(a == b); }
+		template <size_t CAPACITY>
+		inline bool operator!=(const SequenceBuffer<CAPACITY>& a, const std::string& b) { return !(a == b); }
+		template <size_t CAPACITY>
+		inline bool operator!=(const std::string& a, const SequenceBuffer<CAPACITY>& b) { return !(a == b); }
+	}
+}
+
 // –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
 //                                 ECMA-48 C0                                 //
 // –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
@@ -35,41 +230,41 @@ namespace dye {
 		namespace C0 {
 			// The C0 set of control functions is specified in §5.2, p. 8.
 
-			const std::string NUL = "\x00"; // Null                 §8.3.88
-			const std::string SOH = "\x01"; // Start Of Heading     §8.3.127
-			const std::string STX = "\x02"; // Start Of Text        §8.3.146
-			const std::string ETX = "\x03"; // End of Text          §8.3.50
-			const std::string EOT = "\x04"; // End of Transmission  §8.3.45
-			const std::string ENQ = "\x05"; // Enquiry              §8.3.44
-			const std::string ACK = "\x06"; // Acknowledge          §8.3.1
-			const std::string BEL = "\x07"; // Bell                 §8.3.3
-			const std::string BS  = "\x08"; // Backspace            §8.3.5
-			const std::string HT  = "\x09"; // Character Tabulation §8.3.60
-			const std::string LF  = "\x0a"; // Line Feed            §8.3.74
-			const std::string VT  = "\x0b"; // Line Tabulation      §8.3.161
-			const std::string FF  = "\x0c"; // Form Feed            §8.3.51
-			const std::string CR  = "\x0d"; // Carriage Return      §8.3.15
-			const std::string SO  = "\x0e"; // Shift-In             §8.3.119
-			const std::string SI  = "\x0f"; // Shift-Out            §8.3.126
-			const std::string LS1 =   SO  ; // Locking-Shift Zero   §8.3.75
-			const std::string LS0 =   SI  ; // Locking-Shift One    §8.3.76
-
-			const std::string DLE = "\x10"; // Data Link Escape            §8.3.33
-			const std::string DC1 = "\x11"; // Device Control One          §8.3.28
-			const std::string DC2 = "\x12"; // Device Control Two          §8.3.29
-			const std::string DC3 = "\x13"; // Device Control Three        §8.3.30
-			const std::string DC4 = "\x14"; // Device Control Four         §8.3.31
-			const std::string NAK = "\x15"; // Negative Acknowledge        §8.3.84
-			const std::string SYN = "\x16"; // Synchronous Idle            §8.3.150
-			const std::string ETB = "\x17"; // End of Transmission Block   §8.3.49
-			const std::string CAN = "\x18"; // Cancel                      §8.3.6
-			const std::string EM  = "\x19"; // End of Medium               §8.3.42
-			const std::string SUB = "\x1a"; // Substitute                  §8.3.148
-			const std::string ESC = "\x1b"; // Escape                      §8.3.48
-			const std::string IS4 = "\x1c"; // Information Separator One   §8.3.69
-			const std::string IS3 = "\x1d"; // Information Separator Two   §8.3.70
-			const std::string IS2 = "\x1e"; // Information Separator Three §8.3.71
-			const std::string IS1 = "\x1f"; // Information Separator Four  §8.3.72
+			constexpr SequenceView NUL = "\x00"; // Null                 §8.3.88
+			constexpr SequenceView SOH = "\x01"; // Start Of Heading     §8.3.127
+			constexpr SequenceView STX = "\x02"; // Start Of Text        §8.3.146
+			constexpr SequenceView ETX = "\x03"; // End of Text          §8.3.50
+			constexpr SequenceView EOT = "\x04"; // End of Transmission  §8.3.45
+			constexpr SequenceView ENQ = "\x05"; // Enquiry              §8.3.44
+			constexpr SequenceView ACK = "\x06"; // Acknowledge          §8.3.1
+			constexpr SequenceView BEL = "\x07"; // Bell                 §8.3.3
+			constexpr SequenceView BS  = "\x08"; // Backspace            §8.3.5
+			constexpr SequenceView HT  = "\x09"; // Character Tabulation §8.3.60
+			constexpr SequenceView LF  = "\x0a"; // Line Feed            §8.3.74
+			constexpr SequenceView VT  = "\x0b"; // Line Tabulation      §8.3.161
+			constexpr SequenceView FF  = "\x0c"; // Form Feed            §8.3.51
+			constexpr SequenceView CR  = "\x0d"; // Carriage Return      §8.3.15
+			constexpr SequenceView SO  = "\x0e"; // Shift-In             §8.3.119
+			constexpr SequenceView SI  = "\x0f"; // Shift-Out            §8.3.126
+			constexpr SequenceView LS1 =   SO  ; // Locking-Shift Zero   §8.3.75
+			constexpr SequenceView LS0 =   SI  ; // Locking-Shift One    §8.3.76
+
+			constexpr SequenceView DLE = "\x10"; // Data Link Escape            §8.3.33
+			constexpr SequenceView DC1 = "\x11"; // Device Control One          §8.3.28
+			constexpr SequenceView DC2 = "\x12"; // Device Control Two          §8.3.29
+			constexpr SequenceView DC3 = "\x13"; // Device Control Three        §8.3.30
+			constexpr SequenceView DC4 = "\x14"; // Device Control Four         §8.3.31
+			constexpr SequenceView NAK = "\x15"; // Negative Acknowledge        §8.3.84
+			constexpr SequenceView SYN = "\x16"; // Synchronous Idle            §8.3.150
+			constexpr SequenceView ETB = "\x17"; // End of Transmission Block   §8.3.49
+			constexpr SequenceView CAN = "\x18"; // Cancel                      §8.3.6
+			constexpr SequenceView EM  = "\x19"; // End of Medium               §8.3.42
+			constexpr SequenceView SUB = "\x1a"; // Substitute                  §8.3.148
+			constexpr SequenceView ESC = "\x1b"; // Escape                      §8.3.48
+			constexpr SequenceView IS4 = "\x1c"; // Information Separator One   §8.3.69
+			constexpr SequenceView IS3 = "\x1d"; // Information Separator Two   §8.3.70
+			constexpr SequenceView IS2 = "\x1e"; // Information Separator Three §8.3.71
+			constexpr SequenceView IS1 = "\x1f"; // Information Separator Four  §8.3.72
 		}
 	}
 }
@@ -83,49 +278,186 @@ namespace dye {
 		namespace C1 {
 			// The C1 set of control functions is specified in §5.3, pp. 8-10.
 
-			// ·················
-			// Utility functions
-
-			namespace {
-				inline std::string C1(std::string code) {
-					assert(code.size()==1);
-					return C0::ESC + code;
-				}
-			}
-
 			// –––––––––––––––––––––––––––––––
 			// C1 control function definitions
 
 			const size_t LENGTH = 2; // Number of bytes in a C1 control function
 
-			const std::string APC = C1("_");  // Application Program Command §8.3.2
-			const std::string BPH = C1("2");  // Break Permitted Here        §8.3.4
-			const std::string CCH = C1("T");  // Cancel Character            §8.3.8
-			const std::string CSI = C1("[");  // Control Sequence Introducer §8.3.16
-			const std::string DCS = C1("P");  // Device Control String       §8.3.27
-			const std::string EPA = C1("W");  // End of Guarded Area         §8.3.46
-			const std::string ESA = C1("G");  // End of Selected Area        §8.3.47
-			const std::string HTJ = C1("I");  // Character Tabulation With Justification §8.3.61
-			const std::string HTS = C1("H");  // Character Tabulation Set    §8.3.62
-			const std::string MW  = C1("U");  // Message Waiting             §8.3.83
-			const std::string NBH = C1("C");  // No Break Here               §8.3.85
-			const std::string NEL = C1("E");  // Next Line                   §8.3.86
-			const std::string OSC = C1("]");  // Operating System Command    §8.3.89
-			const std::string PLD = C1("K");  // Partial Line Forward        §8.3.92
-			const std::string PLU = C1("L");  // Partial Line Backward       §8.3.93
-			const std::string PM  = C1("^");  // Privacy Message             §8.3.94
-			const std::string PU1 = C1("Q");  // Private Use 1               §8.3.100
-			const std::string PU2 = C1("R");  // Private Use 2               §8.3.101
-			const std::string RI  = C1("M");  // Reverse Line Feed           §8.3.104
-			const std::string SCI = C1("Z");  // Single Character Introducer §8.3.109
-			const std::string SOS = C1("X");  // Start Of String             §8.3.128
-			const std::string SPA = C1("V");  // Start of Guarded Area       §8.3.129
-			const std::string SSA = C1("F");  // Start of Selected Area      §8.3.138
-			const std::string SS2 = C1("N");  // Single Shift Two            §8.3.141
-			const std::string SS3 = C1("O");  // Single Shift Three          §8.3.142
-			const std::string ST  = C1("\\"); // String Terminator           §8.3.143
-			const std::string STS = C1("S");  // Set Transmit State          §8.3.145
-			const std::string VTS = C1("J");  // Line Tabulation Set         §8.3.162
+			constexpr SequenceView APC = "\x1b" "_";  // Application Program Command §8.3.2
+			constexpr SequenceView BPH = "\x1b" "2";  // Break Permitted Here        §8.3.4
+			constexpr SequenceView CCH = "\x1b" "T";  // Cancel Character            §8.3.8
+			constexpr SequenceView CSI = "\x1b" "[";  // Control Sequence Introducer §8.3.16
+			constexpr SequenceView DCS = "\x1b" "P";  // Device Control String       §8.3.27
+			constexpr SequenceView EPA = "\x1b" "W";  // End of Guarded Area         §8.3.46
+			constexpr SequenceView ESA = "\x1b" "G";  // End of Selected Area        §8.3.47
+			constexpr SequenceView HTJ = "\x1b" "I";  // Character Tabulation With Justification §8.3.61
+			constexpr SequenceView HTS = "\x1b" "H";  // Character Tabulation Set    §8.3.62
+			constexpr SequenceView MW  = "\x1b" "U";  // Message Waiting             §8.3.83
+			constexpr SequenceView NBH = "\x1b" "C";  // No Break Here               §8.3.85
+			constexpr SequenceView NEL = "\x1b" "E";  // Next Line                   §8.3.86
+			constexpr SequenceView OSC = "\x1b" "]";  // Operating System Command    §8.3.89
+			constexpr SequenceView PLD = "\x1b" "K";  // Partial Line Forward        §8.3.92
+			constexpr SequenceView PLU = "\x1b" "L";  // Partial Line Backward       §8.3.93
+			constexpr SequenceView PM  = "\x1b" "^";  // Privacy Message             §8.3.94
+			constexpr SequenceView PU1 = "\x1b" "Q";  // Private Use 1               §8.3.100
+			constexpr SequenceView PU2 = "\x1b" "R";  // Private Use 2               §8.3.101
+			constexpr SequenceView RI  = "\x1b" "M";  // Reverse Line Feed           §8.3.104
+			constexpr SequenceView SCI = "\x1b" "Z";  // Single Character Introducer §8.3.109
+			constexpr SequenceView SOS = "\x1b" "X";  // Start Of String             §8.3.128
+			constexpr SequenceView SPA = "\x1b" "V";  // Start of Guarded Area       §8.3.129
+			constexpr SequenceView SSA = "\x1b" "F";  // Start of Selected Area      §8.3.138
+			constexpr SequenceView SS2 = "\x1b" "N";  // Single Shift Two            §8.3.141
+			constexpr SequenceView SS3 = "\x1b" "O";  // Single Shift Three          §8.3.142
+			constexpr SequenceView ST  = "\x1b" "\\"; // String Terminator           §8.3.143
+			constexpr SequenceView STS = "\x1b" "S";  // Set Transmit State          §8.3.145
+			constexpr SequenceView VTS = "\x1b" "J";  // Line Tabulation Set         §8.3.162
+		}
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                   ECMA-48 Compile-time Control Sequences                   //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	namespace ECMA48 {
+		// ·································································
+		// Compile-time generation of control sequence bytes from parameters
+
+		// Named rather than anonymous so that the bytes of a given sequence are
+		// shared between all translation units.
+		namespace detail {
+			template <char... CHARS>
+			struct Chars {
+				static constexpr char   data[sizeof...(CHARS) + 1] = {CHARS..., '\0'};
+				static constexpr size_t size = sizeof...(CHARS);
+			};
+
+			template <char... CHARS>
+			constexpr char Chars<CHARS...>::data[sizeof...(CHARS) + 1];
+
+			template <char... CHARS>
+			constexpr size_t Chars<CHARS...>::size;
+
+			template <typename... CHARS>
+			struct Concat;
+
+			template <char... A>
+			struct Concat< Chars<A...> > {
+				typedef Chars<A...> type;
+			};
+
+			template <char... A, char... B, typename... REST>
+			struct Concat< Chars<A...>, Chars<B...>, REST... > {
+				typedef typename Concat< Chars<A..., B...>, REST... >::type type;
+			};
+
+			template <size_t N, char... DIGITS>
+			struct Digits {
+				typedef typename Digits<N / 10, char('0' + N % 10), DIGITS...>::type type;
+			};
+
+			template <char... DIGITS>
+			struct Digits<0, DIGITS...> {
+				typedef Chars<DIGITS...> type;
+			};
+
+			template <size_t N>
+			struct Decimal {
+				typedef typename Digits<N>::type type;
+			};
+
+			template <>
+			struct Decimal<0> {
+				typedef Chars<'0'> type;
+			};
+
+			// Ps1;Ps2;...;Psn
+			template <size_t... PS>
+			struct Parameters;
+
+			template <>
+			struct Parameters<> {
+				typedef Chars<> type;
+			};
+
+			template <size_t P>
+			struct Parameters<P> {
+				typedef typename Decimal<P>::type type;
+			};
+
+			template <size_t P, size_t Q, size_t... PS>
+			struct Parameters<P, Q, PS...> {
+				typedef typename Concat< typename Decimal<P>::type,
+				                         Chars<';'>,
+				                         typename Parameters<Q, PS...>::type >::type type;
+			};
+
+			// Decimal digits in constant expressions
+
+			constexpr size_t decimal_length(size_t n) {
+				return n < 10 ? 1 : 1 + decimal_length(n / 10);
+			}
+
+			constexpr size_t power_of_ten(size_t exponent) {
+				return exponent == 0 ? 1 : 10 * power_of_ten(exponent - 1);
+			}
+
+			// i-th most significant decimal digit of n
+			constexpr char decimal_digit(size_t n, size_t i) {
+				return char('0' + n / power_of_ten(decimal_length(n) - 1 - i) % 10);
+			}
+
+			template <char FINAL, size_t... PS>
+			struct CSI {
+				typedef typename Concat< Chars<'\x1b', '['>,
+				                         typename Parameters<PS...>::type,
+				                         Chars<FINAL> >::type type;
+			};
+
+			// Bytes of SGR 38;5;code (foreground) or SGR 48;5;code (background) for a
+			// code only known as a constant expression, e.g. while filling a table
+			class IndexedColor {
+				public:
+					constexpr IndexedColor(size_t selector, size_t code)
+						: selector_(selector)
+						, code_(code)
+						{}
+
+					constexpr size_t size() const {
+						return PREFIX_LENGTH + decimal_length(code_) + 1;
+					}
+
+					constexpr char operator[](size_t i) const {
+						return i == 2                                    ? char('0' + selector_ / 10)
+						     : i < PREFIX_LENGTH                         ? "\x1b[_8;5;"[i]
+						     : i < PREFIX_LENGTH + decimal_length(code_) ? decimal_digit(code_, i - PREFIX_LENGTH)
+						     :                                             'm';
+					}
+
+				private:
+					static constexpr size_t PREFIX_LENGTH = 7; // CSI 38;5;
+
+					size_t selector_;
+					size_t code_;
+			};
+		}
+
+		// ––––––––––––––––
+		// Public interface
+
+		// Control sequence with the given final byte and parameters, e.g.
+		// csi<'H',10,20>() is "\x1b[10;20H". The bytes are generated at compile time.
+		template <char FINAL, size_t... PS>
+		constexpr SequenceView csi() {
+			return SequenceView(detail::CSI<FINAL, PS...>::type::data,
+			                    detail::CSI<FINAL, PS...>::type::size);
+		}
+
+		// Select Graphic Rendition with the given parameters, e.g. sgr<38,5,196>()
+		template <size_t... PS>
+		constexpr SequenceView sgr() {
+			return csi<'m', PS...>();
 		}
 	}
 }
@@ -139,29 +471,135 @@ namespace dye {
 		namespace ControlSequence {
 			// Control sequences are specified in §5.4, pp. 10-12
 
+			// ··························································
+			// Allocation-free encoding of control sequences into buffers
+
+			// Number of bytes of the longest parameter value
+			const size_t MAX_DECIMAL_LENGTH = std::numeric_limits<size_t>::digits10 + 1;
+
+			// Number of bytes of a final byte preceded by an optional intermediate byte
+			const size_t MAX_END_DELIMITER_LENGTH = 2;
+
+			// Number of bytes needed to encode a control sequence with the given number
+			// of parameters
+			inline size_t max_length(size_t parameters) {
+				return C1::LENGTH + parameters * (MAX_DECIMAL_LENGTH + 1) + MAX_END_DELIMITER_LENGTH;
+			}
+
+			// Number of bytes needed to encode any of the control sequences below
+			const size_t MAX_LENGTH = C1::LENGTH + 5 * (MAX_DECIMAL_LENGTH + 1) + MAX_END_DELIMITER_LENGTH;
+
+			// Number of bytes of the sequences of default parameters: CSI [value] [;]
+			// end delimiter
+			const size_t DEFAULT_LENGTH = C1::LENGTH + MAX_END_DELIMITER_LENGTH;
+			const size_t DEFAULT_PAIR_LENGTH = DEFAULT_LENGTH + 1;
+			const size_t DEFAULT_VALUE_LENGTH = DEFAULT_LENGTH + MAX_DECIMAL_LENGTH;
+
+			inline size_t decimal_length(size_t n) {
+				size_t length = 1;
+				for (; n >= 100; n /= 100) length += 2;
+				return n >= 10 ? length + 1 : length;
+			}
+
+			// Writes n in decimal at out, two digits at a time, and returns the end of
+			// the written bytes
+			inline char* encode_decimal(char* out, size_t n) {
+				static const char digit_pairs[] =
+					"00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+				char* const end = out + decimal_length(n);
+				char* p = end;
+				for (; n >= 100; n /= 100) {
+					const size_t i = (n % 100) * 2;
+					*--p = digit_pairs[i + 1];
+					*--p = digit_pairs[i];
+				}
+				if (n >= 10) {
+					*--p = digit_pairs[n * 2 + 1];
+					*--p = digit_pairs[n * 2];
+				} else {
+					*--p = static_cast<char>('0' + n);
+				}
+				return end;
+			}
+
+			inline char* encode_CSI(char* out) {
+				out[0] = '\x1b';
+				out[1] = '[';
+				return out + C1::LENGTH;
+			}
+
+			inline char* encode_bytes(char* out, const SequenceView& bytes) {
+				std::memcpy(out, bytes.data(), bytes.size());
+				return out + bytes.size();
+			}
+
+			// Writes CSI s[0];...;s[count-1] followed by end_delimiter. out must have
+			// room for max_length(count) bytes.
+			inline char* encode(char* out,
+			                    const SequenceView& end_delimiter,
+			                    const size_t* s,
+			                    size_t count) {
+				out = encode_CSI(out);
+				for (size_t i = 0; i < count; ++i) {
+					if (i != 0) *out++ = ';';
+					out = encode_decimal(out, s[i]);
+				}
+				return encode_bytes(out, end_delimiter);
+			}
+
 			// ···························································
 			// Helper classes and functions for defining control sequences
 
 			namespace {
-				inline std::string to_string(size_t n) {
-					std::ostringstream s; s<<n; return s.str();
+
+				// CSI [value] [;] end delimiter, with bytes readable in constant
+				// expressions, used to precompute the sequences of default parameters
+				class DefaultSequence {
+					public:
+						constexpr DefaultSequence(SequenceView end_delimiter,
+						                          bool separator,
+						                          bool has_value = false,
+						                          size_t value = 0)
+							: end_delimiter_(end_delimiter)
+							, value_length_(has_value ? detail::decimal_length(value) : 0)
+							, value_(value)
+							, separator_length_(separator ? 1 : 0)
+							{}
+
+						constexpr size_t size() const {
+							return C1::LENGTH + value_length_ + separator_length_ + end_delimiter_.size();
+						}
+
+						constexpr char operator[](size_t i) const {
+							return i < C1::LENGTH ? C1::CSI.data()[i]
+							     : i < C1::LENGTH + value_length_ ? detail::decimal_digit(value_, i - C1::LENGTH)
+							     : i < C1::LENGTH + value_length_ + separator_length_ ? ';'
+							     : end_delimiter_.data()[i - C1::LENGTH - value_length_ - separator_length_];
+						}
+
+					private:
+						SequenceView end_delimiter_;
+						size_t       value_length_;
+						size_t       value_;
+						size_t       separator_length_;
 				};
 
 				class numerical_parameter {
 					public:
 						// Constructors
 
-						numerical_parameter()
+						constexpr numerical_parameter()
 							: has_default_(false)
 							, default_value_()
 							{}
 
-						numerical_parameter(size_t default_value)
+						constexpr numerical_parameter(size_t default_value)
 							: has_default_(true)
 							, default_value_(default_value)
 							{}
 
-						static numerical_parameter no_default() {
+						static constexpr numerical_parameter no_default() {
 							return numerical_parameter();
 						}
 
@@ -197,25 +635,25 @@ namespace dye {
 
 						// Constuctors
 
-						selective_parameter()
+						constexpr selective_parameter()
 							: has_default_(false)
 							, default_value_()
 							, max_(NO_MAX)
 							{}
 
-						selective_parameter(size_t default_value,
-						                    size_t max = NO_MAX)
+						constexpr selective_parameter(size_t default_value,
+						                              size_t max = NO_MAX)
 							: has_default_(true)
 							, default_value_(default_value)
 							, max_(max)
 							{}
 
-						static selective_parameter no_default() {
+						static constexpr selective_parameter no_default() {
 							return selective_parameter();
 						}
 
-						static selective_parameter no_default(size_t new_max) {
-							return selective_parameter().max(new_max);
+						static constexpr selective_parameter no_default(size_t new_max) {
+							return selective_parameter(false, 0, new_max);
 						}
 
 						// Accessors
@@ -252,6 +690,14 @@ namespace dye {
 						}
 
 					private:
+						constexpr selective_parameter(bool has_default,
+						                              size_t default_value,
+						                              size_t max)
+							: has_default_(has_default)
+							, default_value_(default_value)
+							, max_(max)
+							{}
+
 						bool   has_default_;
 						size_t default_value_;
 						size_t max_;
@@ -262,229 +708,274 @@ namespace dye {
 				// (Pn) §8.1.d
 				class Pn {
 					public:
-						Pn(const std::string& end_delimiter)
+						constexpr Pn(SequenceView end_delimiter)
 							: end_delimiter_(end_delimiter)
-							, n_(false)
+							, n_()
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						Pn(const std::string& end_delimiter, size_t default_n)
+						constexpr Pn(SequenceView end_delimiter, size_t default_n)
 							: end_delimiter_(end_delimiter)
 							, n_(default_n)
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
+						inline char* encode(char* out, size_t v) const {
+							out = encode_CSI(out);
+							if (!n_.is_default(v)) out = encode_decimal(out, v);
+							return encode_bytes(out, end_delimiter_);
+						}
+
 						inline std::string operator()(size_t v) const {
-							if (n_.is_default(v))
-								return C1::CSI + end_delimiter_;
-							else
-								return C1::CSI + to_string(v) + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, v));
 						}
 
-						inline const std::string& operator()() const {
+						inline const SequenceBuffer<DEFAULT_LENGTH>& operator()() const {
 							assert(n_.has_default());
-							static const std::string default_parameter_result
-							= operator()(n_.default_value());
-							return default_parameter_result;
+							return default_sequence_;
 						}
 
 					private:
-						const std::string end_delimiter_;
+						const SequenceView end_delimiter_;
 						const numerical_parameter n_;
+						const SequenceBuffer<DEFAULT_LENGTH> default_sequence_;
 				};
 
 				// (Pn1;Pn2) §8.1.e
 				class Pn1Pn2 {
 					public:
-						Pn1Pn2(const std::string& end_delimiter)
+						constexpr Pn1Pn2(SequenceView end_delimiter)
 							: end_delimiter_(end_delimiter)
 							, n1_()
 							, n2_()
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						Pn1Pn2(const std::string& end_delimiter,
-							    size_t default_v1,
-							    size_t default_v2)
+						constexpr Pn1Pn2(SequenceView end_delimiter,
+						                 size_t default_v1,
+						                 size_t default_v2)
 							: end_delimiter_(end_delimiter)
 							, n1_(default_v1)
 							, n2_(default_v2)
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
 
-						Pn1Pn2(const std::string& end_delimiter,
-							    const numerical_parameter& n1,
-							    const numerical_parameter& n2)
+						constexpr Pn1Pn2(SequenceView end_delimiter,
+						                 const numerical_parameter& n1,
+						                 const numerical_parameter& n2)
 							  : end_delimiter_(end_delimiter)
 							  , n1_(n1)
 							  , n2_(n2)
+							  , default_sequence_(DefaultSequence(end_delimiter, false))
 							  {}
 
+						inline char* encode(char* out, size_t v1, size_t v2) const {
+							out = encode_CSI(out);
+							if (!n1_.is_default(v1)) out = encode_decimal(out, v1);
+							// Trailing separators of omitted parameters may be omitted, §5.4.2
+							if (!n2_.is_default(v2)) {
+								*out++ = ';';
+								out = encode_decimal(out, v2);
+							}
+							return encode_bytes(out, end_delimiter_);
+						}
+
 						inline std::string operator()(size_t v1, size_t v2) const {
-							if (n1_.is_default(v1) && n2_.is_default(v2))
-								return C1::CSI + ";" + end_delimiter_;
-							else if (n1_.is_default(v1) && !n2_.is_default(v2))
-								return C1::CSI + ";" + to_string(v2) + end_delimiter_;
-							else if (!n1_.is_default(v1) && n2_.is_default(v2))
-								return C1::CSI + to_string(v1) + ";" + end_delimiter_;
-							else
-								return C1::CSI
-								     + to_string(v1) + ";" + to_string(v2)
-								     + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, v1, v2));
 						}
 
-						inline const std::string& operator()() const {
+						// Same bytes as encode() of the default values: CSI and the end
+						// delimiter, without separator
+						inline const SequenceBuffer<DEFAULT_PAIR_LENGTH>& operator()() const {
 							assert(n1_.has_default());
 							assert(n2_.has_default());
-							static const std::string default_parameter_result
-							= operator()(n1_.default_value(), n2_.default_value());
-							return default_parameter_result;
+							return default_sequence_;
 						}
 
 					private:
-						const std::string end_delimiter_;
+						const SequenceView end_delimiter_;
 						const numerical_parameter n1_;
 						const numerical_parameter n2_;
+						const SequenceBuffer<DEFAULT_PAIR_LENGTH> default_sequence_;
 				};
 
 				// (Ps) §8.1.g
 				class Ps {
 					public:
-						Ps(const std::string& end_delimiter)
+						constexpr Ps(SequenceView end_delimiter)
 							: end_delimiter_(end_delimiter)
 							, s_()
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						Ps(const std::string& end_delimiter,
-						   const selective_parameter& s)
+						constexpr Ps(SequenceView end_delimiter,
+						             const selective_parameter& s)
 							: end_delimiter_(end_delimiter)
 							, s_(s)
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						Ps(const std::string& end_delimiter,
-						   size_t default_s)
+						constexpr Ps(SequenceView end_delimiter,
+						             size_t default_s)
 							: end_delimiter_(end_delimiter)
 							, s_(default_s)
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						Ps(const std::string& end_delimiter,
-						   size_t default_s,
-						   size_t max_s)
+						constexpr Ps(SequenceView end_delimiter,
+						             size_t default_s,
+						             size_t max_s)
 							: end_delimiter_(end_delimiter)
 							, s_(default_s, max_s)
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						inline std::string operator()(size_t s) const {
+						inline char* encode(char* out, size_t s) const {
 							assert(s <= s_.max());
-							if (s_.is_default(s))
-								return C1::CSI + end_delimiter_;
-							else
-								return C1::CSI + to_string(s) + end_delimiter_;
+							out = encode_CSI(out);
+							if (!s_.is_default(s)) out = encode_decimal(out, s);
+							return encode_bytes(out, end_delimiter_);
+						}
+
+						inline std::string operator()(size_t s) const {
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, s));
 						}
 
-						inline const std::string& operator()() const {
+						inline const SequenceBuffer<DEFAULT_LENGTH>& operator()() const {
 							assert(s_.has_default());
-							static const std::string default_parameter_result
-							= operator()(s_.default_value());
-							return default_parameter_result;
+							return default_sequence_;
 						}
 
 					private:
-						const std::string end_delimiter_;
+						const SequenceView end_delimiter_;
 						const selective_parameter s_;
+						const SequenceBuffer<DEFAULT_LENGTH> default_sequence_;
 				};
 
 				// (Ps1;Ps2) §8.1.h
 				class Ps1Ps2 {
 					public:
-						Ps1Ps2(const std::string& end_delimiter,
-						       const selective_parameter& s1,
-						       const selective_parameter& s2)
+						constexpr Ps1Ps2(SequenceView end_delimiter,
+						                 const selective_parameter& s1,
+						                 const selective_parameter& s2)
 							  : end_delimiter_(end_delimiter)
 							  , s1_(s1)
 							  , s2_(s2)
+							  , default_sequence_(DefaultSequence(end_delimiter, true))
 							  {}
 
-						inline std::string operator()(size_t v1, size_t v2) const {
+						inline char* encode(char* out, size_t v1, size_t v2) const {
 							assert(v1 <= s1_.max());
 							assert(v2 <= s2_.max());
-							if (s1_.is_default(v1) && s2_.is_default(v2))
-								return C1::CSI + ";" + end_delimiter_;
-							else if (s1_.is_default(v1) && !s2_.is_default(v2))
-								return C1::CSI + ";" + to_string(v2) + end_delimiter_;
-							else if (!s1_.is_default(v1) && s2_.is_default(v2))
-								return C1::CSI + to_string(v1) + ";" + end_delimiter_;
-							else
-								return C1::CSI
-								     + to_string(v1) + ";" + to_string(v2)
-								     + end_delimiter_;
+							out = encode_CSI(out);
+							if (!s1_.is_default(v1)) out = encode_decimal(out, v1);
+							*out++ = ';';
+							if (!s2_.is_default(v2)) out = encode_decimal(out, v2);
+							return encode_bytes(out, end_delimiter_);
+						}
+
+						inline std::string operator()(size_t v1, size_t v2) const {
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, v1, v2));
 						}
 
-						inline const std::string& operator()() const {
+						inline const SequenceBuffer<DEFAULT_PAIR_LENGTH>& operator()() const {
 							assert(s1_.has_default());
 							assert(s2_.has_default());
-							static const std::string default_parameter_result
-							= operator()(s1_.default_value(), s2_.default_value());
-							return default_parameter_result;
+							return default_sequence_;
 						}
 
 					private:
-						const std::string end_delimiter_;
+						const SequenceView end_delimiter_;
 						const selective_parameter s1_;
 						const selective_parameter s2_;
+						const SequenceBuffer<DEFAULT_PAIR_LENGTH> default_sequence_;
 				};
 
 				// (Ps...) §8.1.i
 				class Psx {
 					public:
-						Psx(const std::string& end_delimiter)
+						constexpr Psx(SequenceView end_delimiter)
 							: end_delimiter_(end_delimiter)
 							, s_()
+							, default_sequence_(DefaultSequence(end_delimiter, false))
 							{}
 
-						Psx(const std::string& end_delimiter,
-							 size_t default_s)
+						constexpr Psx(SequenceView end_delimiter,
+						              size_t default_s)
 							: end_delimiter_(end_delimiter)
 							, s_(default_s)
+							, default_sequence_(DefaultSequence(end_delimiter, false, true, default_s))
 							{}
 
-						Psx(const std::string& end_delimiter,
-							 size_t default_s,
-							 size_t max_s)
+						constexpr Psx(SequenceView end_delimiter,
+						              size_t default_s,
+						              size_t max_s)
 							: end_delimiter_(end_delimiter)
 							, s_(default_s, max_s)
+							, default_sequence_(DefaultSequence(end_delimiter, false, true, default_s))
 							{}
 
-						inline const std::string& operator()() const {
-							static std::string default_parameter_result;
-							if (s_.has_default())
-								default_parameter_result = operator()(s_.default_value());
-							else
-								default_parameter_result = C1::CSI + end_delimiter_;
-							return default_parameter_result;
+						inline const SequenceBuffer<DEFAULT_VALUE_LENGTH>& operator()() const {
+							return default_sequence_;
+						}
+
+						inline char* encode(char* out, const size_t* s, size_t count) const {
+							return ControlSequence::encode(out, end_delimiter_, s, count);
+						}
+
+						inline char* encode(char* out, size_t s1) const {
+							return encode(out, &s1, 1);
+						}
+
+						inline char* encode(char* out, size_t s1, size_t s2) const {
+							const size_t s[] = {s1, s2};
+							return encode(out, s, 2);
+						}
+
+						inline char* encode(char* out, size_t s1, size_t s2, size_t s3) const {
+							const size_t s[] = {s1, s2, s3};
+							return encode(out, s, 3);
+						}
+
+						inline char* encode(char* out, size_t s1, size_t s2, size_t s3, size_t s4) const {
+							const size_t s[] = {s1, s2, s3, s4};
+							return encode(out, s, 4);
+						}
+
+						inline
+						char* encode(char* out,
+						             size_t s1,
+						             size_t s2,
+						             size_t s3,
+						             size_t s4,
+						             size_t s5) const {
+							const size_t s[] = {s1, s2, s3, s4, s5};
+							return encode(out, s, 5);
 						}
 
 						inline std::string operator()(size_t s) const {
-							return C1::CSI + to_string(s)
-							               + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, s));
 						}
 
 						inline std::string operator()(size_t s1, size_t s2) const {
-							return C1::CSI + to_string(s1)
-							         + ";" + to_string(s2)
-							               + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, s1, s2));
 						}
 
 						inline std::string operator()(size_t s1, size_t s2, size_t s3) const {
-							return C1::CSI + to_string(s1)
-							         + ";" + to_string(s2)
-							         + ";" + to_string(s3)
-							               + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, s1, s2, s3));
 						}
 
 						inline std::string operator()(size_t s1, size_t s2, size_t s3, size_t s4) const {
-							return C1::CSI + to_string(s1)
-							         + ";" + to_string(s2)
-							         + ";" + to_string(s3)
-							         + ";" + to_string(s4)
-							               + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, s1, s2, s3, s4));
 						}
 
 						inline
@@ -493,211 +984,212 @@ namespace dye {
 						                       size_t s3,
 						                       size_t s4,
 						                       size_t s5) const {
-							return C1::CSI + to_string(s1)
-							         + ";" + to_string(s2)
-							         + ";" + to_string(s3)
-							         + ";" + to_string(s4)
-							         + ";" + to_string(s5)
-							               + end_delimiter_;
+							char buffer[MAX_LENGTH];
+							return std::string(buffer, encode(buffer, s1, s2, s3, s4, s5));
 						}
 
 					private:
-						const std::string end_delimiter_;
+						const SequenceView end_delimiter_;
 						const selective_parameter s_;
+						const SequenceBuffer<DEFAULT_VALUE_LENGTH> default_sequence_;
 				};
 			}
 
 			// –––––––––––––––––––––––––––––––––––––––––
 			// Control sequences with final byte in 0x4·
 
-			const Pn ICH("@", 1); // Insert Character          §8.3.64
-			const Pn CUU("A", 1); // Cursor Up                 §8.3.22
-			const Pn CUD("B", 1); // Cursor Down               §8.3.19
-			const Pn CUF("C", 1); // Cursor Right              §8.3.20
-			const Pn CUB("D", 1); // Cursor Left               §8.3.18
-			const Pn CNL("E", 1); // Cursor Next Line          §8.3.12
-			const Pn CPL("F", 1); // Cursor Preceding Line     §8.3.13
-			const Pn CHA("G", 1); // Cursor Character Absolute §8.3.9
-			const Pn1Pn2 CUP("H", 1, 1); // Cursor Position    §8.3.21
-			const Pn CHT("I", 1); // Cursor Forward Tabulation §8.3.10
-			const Pn  ED("J", 0); // Erase in Page             §8.3.39
-			const Pn  EL("K", 0); // Erase in Line             §8.3.41
-			const Pn  IL("L", 1); // Insert Line               §8.3.67
-			const Pn  DL("M", 1); // Delete Line               §8.3.32
-			const Pn  EF("N", 0); // Erase in Field            §8.3.40
-			const Pn  EA("O", 0); // Erase in Area             §8.3.37
+			constexpr Pn ICH("@", 1); // Insert Character          §8.3.64
+			constexpr Pn CUU("A", 1); // Cursor Up                 §8.3.22
+			constexpr Pn CUD("B", 1); // Cursor Down               §8.3.19
+			constexpr Pn CUF("C", 1); // Cursor Right              §8.3.20
+			constexpr Pn CUB("D", 1); // Cursor Left               §8.3.18
+			constexpr Pn CNL("E", 1); // Cursor Next Line          §8.3.12
+			constexpr Pn CPL("F", 1); // Cursor Preceding Line     §8.3.13
+			constexpr Pn CHA("G", 1); // Cursor Character Absolute §8.3.9
+			constexpr Pn1Pn2 CUP("H", 1, 1); // Cursor Position    §8.3.21
+			constexpr Pn CHT("I", 1); // Cursor Forward Tabulation §8.3.10
+			constexpr Pn  ED("J", 0); // Erase in Page             §8.3.39
+			constexpr Pn  EL("K", 0); // Erase in Line             §8.3.41
+			constexpr Pn  IL("L", 1); // Insert Line               §8.3.67
+			constexpr Pn  DL("M", 1); // Delete Line               §8.3.32
+			constexpr Pn  EF("N", 0); // Erase in Field            §8.3.40
+			constexpr Pn  EA("O", 0); // Erase in Area             §8.3.37
 
 			// –––––––––––––––––––––––––––––––––––––––––
 			// Control sequences with final byte in 0x5·
 
-			const Pn     DCH("P",  1);    // Delete Character                   §8.3.26
-			const Ps     SEE("Q",  0, 4); // Select Editing Extent              §8.3.115
-			const Pn1Pn2 CPR("R",  1, 1); // Active Position Report             §8.3.14
-			const Pn      SU("S",  1);    // Scroll Up                          §8.3.147
-			const Pn      SD("T",  1);    // Scroll Down                        §8.3.113
-			const Pn      NP("U",  1);    // Next Page                          §8.3.87
-			const Pn      PP("V",  1);    // Previous Page                      §8.3.95
-			const Psx    CTC("W",  0, 6); // Cursor Tabulation Control          §8.3.17
-			const Pn     ECH("X",  1);    // Erase Character                    §8.3.38
-			const Pn     CVT("Y",  1);    // Cursor Line Tabulation             §8.3.23
-			const Pn     CBT("Z",  1);    // Cursor Backward Tabulation         §8.3.7
-			const Ps     SRS("[",  0, 1); // Start Reversed String              §8.3.137
-			const Ps     PTX("\\", 0, 5); // Parallel Texts                     §8.3.99
-			const Ps     SDS("]",  0, 2); // Start Directer String              §8.3.114
-			const Ps    SIMD("^",  0, 1); // Select Implicit Movement Direction §8.3.120
+			constexpr Pn     DCH("P",  1);    // Delete Character                   §8.3.26
+			constexpr Ps     SEE("Q",  0, 4); // Select Editing Extent              §8.3.115
+			constexpr Pn1Pn2 CPR("R",  1, 1); // Active Position Report             §8.3.14
+			constexpr Pn      SU("S",  1);    // Scroll Up                          §8.3.147
+			constexpr Pn      SD("T",  1);    // Scroll Down                        §8.3.113
+			constexpr Pn      NP("U",  1);    // Next Page                          §8.3.87
+			constexpr Pn      PP("V",  1);    // Previous Page                      §8.3.95
+			constexpr Psx    CTC("W",  0, 6); // Cursor Tabulation Control          §8.3.17
+			constexpr Pn     ECH("X",  1);    // Erase Character                    §8.3.38
+			constexpr Pn     CVT("Y",  1);    // Cursor Line Tabulation             §8.3.23
+			constexpr Pn     CBT("Z",  1);    // Cursor Backward Tabulation         §8.3.7
+			constexpr Ps     SRS("[",  0, 1); // Start Reversed String              §8.3.137
+			constexpr Ps     PTX("\\", 0, 5); // Parallel Texts                     §8.3.99
+			constexpr Ps     SDS("]",  0, 2); // Start Directer String              §8.3.114
+			constexpr Ps    SIMD("^",  0, 1); // Select Implicit Movement Direction §8.3.120
 
 			// –––––––––––––––––––––––––––––––––––––––––
 			// Control sequences with final byte in 0x6·
 
-			const Pn     HPA("`", 1);    // Character Position Absolute §8.3.57
-			const Pn     HPR("a", 1);    // Character Position Forward  §8.3.59
-			const Pn     REP("b", 1);    // Repeat                      §8.3.103
-			const Ps      DA("c", 0);    // Device Attributes           §8.3.24
-			const Pn     VPA("d", 1);    // Line Position Absolute      §8.3.158
-			const Pn     VPR("e", 1);    // Line Position Forward       §8.3.160
-			const Pn1Pn2 HVP("f", 1, 1); // Character and Line Position §8.3.63
-			const Ps     TBC("g", 0, 5); // Tabulation Clear            §8.3.154
-			const Ps      SM("h", s().max(22)); // Set Mode             §8.3.125
-			const Ps      MC("i", 0, 7); // Media Copy                  §8.3.82
-			const Pn     HPB("j", 1);    // Character Position Backward §8.3.58
-			const Pn     VPB("k", 1);    // Line Position Backward      §8.3.159
-			const Ps      RM("l", s().max(22)); // Reset Mode           §8.3.106
-			const Psx    SGR("m", 0, 65); // Select Graphic Rendition   §8.3.117
-			const Ps     DSR("n", 0, 6);  // Device Status Report       §8.3.35
-			const Ps     DAQ("o", 0, 11); // Define Area Qualification  §8.3.25
+			constexpr Pn     HPA("`", 1);    // Character Position Absolute §8.3.57
+			constexpr Pn     HPR("a", 1);    // Character Position Forward  §8.3.59
+			constexpr Pn     REP("b", 1);    // Repeat                      §8.3.103
+			constexpr Ps      DA("c", 0);    // Device Attributes           §8.3.24
+			constexpr Pn     VPA("d", 1);    // Line Position Absolute      §8.3.158
+			constexpr Pn     VPR("e", 1);    // Line Position Forward       §8.3.160
+			constexpr Pn1Pn2 HVP("f", 1, 1); // Character and Line Position §8.3.63
+			constexpr Ps     TBC("g", 0, 5); // Tabulation Clear            §8.3.154
+			constexpr Ps      SM("h", s::no_default(22)); // Set Mode             §8.3.125
+			constexpr Ps      MC("i", 0, 7); // Media Copy                  §8.3.82
+			constexpr Pn     HPB("j", 1);    // Character Position Backward §8.3.58
+			constexpr Pn     VPB("k", 1);    // Line Position Backward      §8.3.159
+			constexpr Ps      RM("l", s::no_default(22)); // Reset Mode           §8.3.106
+			constexpr Psx    SGR("m", 0, 65); // Select Graphic Rendition   §8.3.117
+			constexpr Ps     DSR("n", 0, 6);  // Device Status Report       §8.3.35
+			constexpr Ps     DAQ("o", 0, 11); // Define Area Qualification  §8.3.25
 
 			// ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
 			// Control sequences with intermediate byte 0x20 and final byte in 0x4·
 
-			const Pn      SL(" @", 1);     // Scroll Left                    §8.3.121
-			const Pn      SR(" A", 1);     // Scroll Right                   §8.3.135
-			const Pn1Pn2 GSM(" B", 100, 100); // Graphic Size Modification   §8.3.55
-			const Pn     GSS(" C");        // Graphic Size Selection         §8.3.56
-			const Ps1Ps2 FNT(" D", s(0).max(9), s(0)); // Font Selection     §8.3.53
-			const Pn     TSS(" E");        // Thin Space Specification       §8.3.157
-			const Psx    JFY(" F", 0, 8);  // Justify                        §8.3.73
-			const Pn1Pn2 SPI(" G");        // Spacing Increment              §8.3.132
-			const Psx   QUAD(" H", 0, 6);  // Quad                           §8.3.102
-			const Ps     SSU(" I", 0, 8);  // Select Size Unit               §8.3.139
-			const Ps     PFS(" J", 0, 15); // Page Format Selection          §8.3.91
-			const Ps     SHS(" K", 0, 6);  // Select Character Spacing       §8.3.118
-			const Ps     SVS(" L", 0, 9);  // Select Line Spacing            §8.3.149
-			const Ps     IGS(" M");        // Identify Graphic Subrepertoire §8.3.66
-			const Ps    IDCS(" O", s().max(2));// Identify Device Control String §8.3.65
+			constexpr Pn      SL(" @", 1);     // Scroll Left                    §8.3.121
+			constexpr Pn      SR(" A", 1);     // Scroll Right                   §8.3.135
+			constexpr Pn1Pn2 GSM(" B", 100, 100); // Graphic Size Modification   §8.3.55
+			constexpr Pn     GSS(" C");        // Graphic Size Selection         §8.3.56
+			constexpr Ps1Ps2 FNT(" D", s(0,9), s(0)); // Font Selection     §8.3.53
+			constexpr Pn     TSS(" E");        // Thin Space Specification       §8.3.157
+			constexpr Psx    JFY(" F", 0, 8);  // Justify                        §8.3.73
+			constexpr Pn1Pn2 SPI(" G");        // Spacing Increment              §8.3.132
+			constexpr Psx   QUAD(" H", 0, 6);  // Quad                           §8.3.102
+			constexpr Ps     SSU(" I", 0, 8);  // Select Size Unit               §8.3.139
+			constexpr Ps     PFS(" J", 0, 15); // Page Format Selection          §8.3.91
+			constexpr Ps     SHS(" K", 0, 6);  // Select Character Spacing       §8.3.118
+			constexpr Ps     SVS(" L", 0, 9);  // Select Line Spacing            §8.3.149
+			constexpr Ps     IGS(" M");        // Identify Graphic Subrepertoire §8.3.66
+			constexpr Ps    IDCS(" O", s::no_default(2));// Identify Device Control String §8.3.65
 
 			// ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
 			// Control sequences with intermediate byte 0x20 and final byte in 0x5·
 
-			const Pn     PPA(" P", 1);     // Page Position Absolute                   §8.3.96
-			const Pn     PPR(" Q", 1);     // Page Position Forward                    §8.3.98
-			const Pn     PPB(" R", 1);     // Page Position Backward                   §8.3.97
-			const Ps1Ps2 SPD(" S", s(0,7), s(0,3)); // Select Presentation Directions  §8.3.126
-			const Pn1Pn2 DTA(" T");        // Dimension Text Area                      §8.3.36
-			const Pn     SLH(" U");        // Set Line Home                            §8.3.122
-			const Pn     SLL(" V");        // Set Line Limit                           §8.3.123
-			const Pn     FNK(" W");        // Function Key                             §8.3.52
-			const Ps    SPQR(" X", 0, 2);  // Select Print Quality and Rapidity        §8.3.134
-			const Ps1Ps2 SEF(" Y", s(0,2), s(0,2)); // Sheet Eject and Feed            §8.3.116
-			const Ps     PEC(" Z", 0, 2);  // Presentation Expand or Contract          §8.3.90
-			const Pn     SSW(" [");        // Select Space Width                       §8.3.140
-			const Pn    SACS(" \\", 0);    // Set Additional Character Separation      §8.3.107
-			const Psx   SAPV(" ]", 0, 22); // Select Alternative Presentation Variants §8.3.108
-			const Ps    STAB(" ^");        // Selective Tabulation                     §8.3.144
-			const Ps     GCC(" _", 0, 2);  // Graphic Character Combination            §8.3.54
+			constexpr Pn     PPA(" P", 1);     // Page Position Absolute                   §8.3.96
+			constexpr Pn     PPR(" Q", 1);     // Page Position Forward                    §8.3.98
+			constexpr Pn     PPB(" R", 1);     // Page Position Backward                   §8.3.97
+			constexpr Ps1Ps2 SPD(" S", s(0,7), s(0,3)); // Select Presentation Directions  §8.3.126
+			constexpr Pn1Pn2 DTA(" T");        // Dimension Text Area                      §8.3.36
+			constexpr Pn     SLH(" U");        // Set Line Home                            §8.3.122
+			constexpr Pn     SLL(" V");        // Set Line Limit                           §8.3.123
+			constexpr Pn     FNK(" W");        // Function Key                             §8.3.52
+			constexpr Ps    SPQR(" X", 0, 2);  // Select Print Quality and Rapidity        §8.3.134
+			constexpr Ps1Ps2 SEF(" Y", s(0,2), s(0,2)); // Sheet Eject and Feed            §8.3.116
+			constexpr Ps     PEC(" Z", 0, 2);  // Presentation Expand or Contract          §8.3.90
+			constexpr Pn     SSW(" [");        // Select Space Width                       §8.3.140
+			constexpr Pn    SACS(" \\", 0);    // Set Additional Character Separation      §8.3.107
+			constexpr Psx   SAPV(" ]", 0, 22); // Select Alternative Presentation Variants §8.3.108
+			constexpr Ps    STAB(" ^");        // Selective Tabulation                     §8.3.144
+			constexpr Ps     GCC(" _", 0, 2);  // Graphic Character Combination            §8.3.54
 
 			// ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
 			// Control sequences with intermediate byte 0x20 and final byte in 0x6·
 
-			const Pn    TATE("`");             // Tabulation Aligned Trailing Edge  §8.3.153
-			const Pn    TALE("a");             // Tabulation Aligned Leading Edge   §8.3.152
-			const Pn     TAC("b");             // Tabulation Aligned Centred        §8.3.151
-			const Pn1Pn2 TCC("c", n(), n(32)); // Tabulation Centred on Character   §8.3.155
-			const Pn     TSR("d");             // Tabulation Stop Remove            §8.3.156
-			const Ps     SCO("e", 0, 7);       // Set Character Orientation         §8.3.110
-			const Pn    SRCS("f", 0);          // Set Reduced Character Separation  §8.3.136
-			const Pn     SCS("g");             // Set Character Spacing             §8.3.112
-			const Pn     SLS("h");             // Set Line Spacing                  §8.3.124
-			const Pn     SPH("i");             // Set Page Home                     §8.3.131
-			const Pn     SPL("j");             // Set Page Limit                    §8.3.133
-			const Ps1Ps2 SCP("k", s().max(2), s().max(2)); // Select Character Path §8.3.111
+			constexpr Pn    TATE("`");             // Tabulation Aligned Trailing Edge  §8.3.153
+			constexpr Pn    TALE("a");             // Tabulation Aligned Leading Edge   §8.3.152
+			constexpr Pn     TAC("b");             // Tabulation Aligned Centred        §8.3.151
+			constexpr Pn1Pn2 TCC("c", n(), n(32)); // Tabulation Centred on Character   §8.3.155
+			constexpr Pn     TSR("d");             // Tabulation Stop Remove            §8.3.156
+			constexpr Ps     SCO("e", 0, 7);       // Set Character Orientation         §8.3.110
+			constexpr Pn    SRCS("f", 0);          // Set Reduced Character Separation  §8.3.136
+			constexpr Pn     SCS("g");             // Set Character Spacing             §8.3.112
+			constexpr Pn     SLS("h");             // Set Line Spacing                  §8.3.124
+			constexpr Pn     SPH("i");             // Set Page Home                     §8.3.131
+			constexpr Pn     SPL("j");             // Set Page Limit                    §8.3.133
+			constexpr Ps1Ps2 SCP("k", s::no_default(2), s::no_default(2)); // Select Character Path §8.3.111
 
 		}
 
 		// –––––––––––––––––––––
 		// SGR control sequences
 
-		const std::string                  reset = ControlSequence::SGR(0);
-		const std::string                   bold = ControlSequence::SGR(1);
-		const std::string                  faint = ControlSequence::SGR(2);
-		const std::string                 italic = ControlSequence::SGR(3);
-		const std::string             underlined = ControlSequence::SGR(4);
-		const std::string          slow_blinking = ControlSequence::SGR(5);
-		const std::string         rapid_blinking = ControlSequence::SGR(6);
-		const std::string               negative = ControlSequence::SGR(7);
-		const std::string              concealed = ControlSequence::SGR(8);
-		const std::string                crossed = ControlSequence::SGR(9);
-		const std::string                  font0 = ControlSequence::SGR(11);
-		const std::string                  font1 = ControlSequence::SGR(11);
-		const std::string                  font2 = ControlSequence::SGR(12);
-		const std::string                  font3 = ControlSequence::SGR(13);
-		const std::string                  font4 = ControlSequence::SGR(14);
-		const std::string                  font5 = ControlSequence::SGR(15);
-		const std::string                  font6 = ControlSequence::SGR(16);
-		const std::string                  font7 = ControlSequence::SGR(17);
-		const std::string                  font8 = ControlSequence::SGR(18);
-		const std::string                  font9 = ControlSequence::SGR(19);
-		const std::string                fraktur = ControlSequence::SGR(20);
-		const std::string      doubly_underlined = ControlSequence::SGR(21);
-		const std::string     not_bold_not_faint = ControlSequence::SGR(22);
-		const std::string not_italic_not_fraktur = ControlSequence::SGR(23);
-		const std::string         not_underlined = ControlSequence::SGR(24);
-		const std::string           not_blinking = ControlSequence::SGR(25);
-		const std::string         positive_image = ControlSequence::SGR(27);
-		const std::string               revealed = ControlSequence::SGR(28);
-		const std::string            not_crossed = ControlSequence::SGR(29);
-
-		const std::string   black = ControlSequence::SGR(30);
-		const std::string     red = ControlSequence::SGR(31);
-		const std::string   green = ControlSequence::SGR(32);
-		const std::string  yellow = ControlSequence::SGR(33);
-		const std::string    blue = ControlSequence::SGR(34);
-		const std::string magenta = ControlSequence::SGR(35);
-		const std::string    cyan = ControlSequence::SGR(36);
-		const std::string   white = ControlSequence::SGR(37);
+		constexpr SequenceView                  reset = sgr<0>();
+		constexpr SequenceView                   bold = sgr<1>();
+		constexpr SequenceView                  faint = sgr<2>();
+		constexpr SequenceView                 italic = sgr<3>();
+		constexpr SequenceView             underlined = sgr<4>();
+		constexpr SequenceView          slow_blinking = sgr<5>();
+		constexpr SequenceView         rapid_blinking = sgr<6>();
+		constexpr SequenceView               negative = sgr<7>();
+		constexpr SequenceView              concealed = sgr<8>();
+		constexpr SequenceView                crossed = sgr<9>();
+		constexpr SequenceView                  font0 = sgr<10>();
+		constexpr SequenceView                  font1 = sgr<11>();
+		constexpr SequenceView                  font2 = sgr<12>();
+		constexpr SequenceView                  font3 = sgr<13>();
+		constexpr SequenceView                  font4 = sgr<14>();
+		constexpr SequenceView                  font5 = sgr<15>();
+		constexpr SequenceView                  font6 = sgr<16>();
+		constexpr SequenceView                  font7 = sgr<17>();
+		constexpr SequenceView                  font8 = sgr<18>();
+		constexpr SequenceView                  font9 = sgr<19>();
+		constexpr SequenceView                fraktur = sgr<20>();
+		constexpr SequenceView      doubly_underlined = sgr<21>();
+		constexpr SequenceView     not_bold_not_faint = sgr<22>();
+		constexpr SequenceView not_italic_not_fraktur = sgr<23>();
+		constexpr SequenceView         not_underlined = sgr<24>();
+		constexpr SequenceView           not_blinking = sgr<25>();
+		constexpr SequenceView         positive_image = sgr<27>();
+		constexpr SequenceView               revealed = sgr<28>();
+		constexpr SequenceView            not_crossed = sgr<29>();
+
+		constexpr SequenceView   black = sgr<30>();
+		constexpr SequenceView     red = sgr<31>();
+		constexpr SequenceView   green = sgr<32>();
+		constexpr SequenceView  yellow = sgr<33>();
+		constexpr SequenceView    blue = sgr<34>();
+		constexpr SequenceView magenta = sgr<35>();
+		constexpr SequenceView    cyan = sgr<36>();
+		constexpr SequenceView   white = sgr<37>();
+		inline char* encode_foreground_256(char* out, size_t code) { return ControlSequence::SGR.encode(out,38,5,code); }
+		inline char* encode_foreground_24bit(char* out, size_t r, size_t g, size_t b) { return ControlSequence::SGR.encode(out,38,2,r,g,b); }
 		inline std::string foreground_256(size_t code) { return ControlSequence::SGR(38,5,code); }
 		inline std::string foreground_24bit(size_t r, size_t g, size_t b) { return ControlSequence::SGR(38,2,r,g,b); }
-		const std::string default_color = ControlSequence::SGR(39);
-
-		const std::string   black_background = ControlSequence::SGR(40);
-		const std::string     red_background = ControlSequence::SGR(41);
-		const std::string   green_background = ControlSequence::SGR(42);
-		const std::string  yellow_background = ControlSequence::SGR(43);
-		const std::string    blue_background = ControlSequence::SGR(44);
-		const std::string magenta_background = ControlSequence::SGR(45);
-		const std::string    cyan_background = ControlSequence::SGR(46);
-		const std::string   white_background = ControlSequence::SGR(47);
+		constexpr SequenceView default_color = sgr<39>();
+
+		constexpr SequenceView   black_background = sgr<40>();
+		constexpr SequenceView     red_background = sgr<41>();
+		constexpr SequenceView   green_background = sgr<42>();
+		constexpr SequenceView  yellow_background = sgr<43>();
+		constexpr SequenceView    blue_background = sgr<44>();
+		constexpr SequenceView magenta_background = sgr<45>();
+		constexpr SequenceView    cyan_background = sgr<46>();
+		constexpr SequenceView   white_background = sgr<47>();
+		inline char* encode_background_256(char* out, size_t code) { return ControlSequence::SGR.encode(out,48,5,code); }
+		inline char* encode_background_24bit(char* out, size_t r, size_t g, size_t b) { return ControlSequence::SGR.encode(out,48,2,r,g,b); }
 		inline std::string background_256(size_t code) { return ControlSequence::SGR(48,5,code); }
 		inline std::string background_24bit(size_t r, size_t g, size_t b) { return ControlSequence::SGR(48,2,r,g,b); }
-		const std::string default_background = ControlSequence::SGR(49);
-
-		const std::string                   framed = ControlSequence::SGR(51);
-		const std::string                encircled = ControlSequence::SGR(52);
-		const std::string                overlined = ControlSequence::SGR(53);
-		const std::string not_framed_not_encircled = ControlSequence::SGR(54);
-		const std::string            not_overlined = ControlSequence::SGR(55);
-
-		const std::string ideogram_underline        = ControlSequence::SGR(60);
-		const std::string ideogram_double_underline = ControlSequence::SGR(61);
-		const std::string ideogram_overline         = ControlSequence::SGR(62);
-		const std::string ideogram_double_overline  = ControlSequence::SGR(63);
-		const std::string ideogram_stress_marking   = ControlSequence::SGR(64);
-		const std::string not_ideogram              = ControlSequence::SGR(65);
-
-		const std::string        right_side_line = ideogram_underline;
-		const std::string double_right_side_line = ideogram_double_underline;
-		const std::string         left_side_line = ideogram_overline;
-		const std::string  double_left_side_line = ideogram_double_overline;
-		const std::string          not_side_line = not_ideogram;
+		constexpr SequenceView default_background = sgr<49>();
+
+		constexpr SequenceView                   framed = sgr<51>();
+		constexpr SequenceView                encircled = sgr<52>();
+		constexpr SequenceView                overlined = sgr<53>();
+		constexpr SequenceView not_framed_not_encircled = sgr<54>();
+		constexpr SequenceView            not_overlined = sgr<55>();
+
+		constexpr SequenceView ideogram_underline        = sgr<60>();
+		constexpr SequenceView ideogram_double_underline = sgr<61>();
+		constexpr SequenceView ideogram_overline         = sgr<62>();
+		constexpr SequenceView ideogram_double_overline  = sgr<63>();
+		constexpr SequenceView ideogram_stress_marking   = sgr<64>();
+		constexpr SequenceView not_ideogram              = sgr<65>();
+
+		constexpr SequenceView        right_side_line = ideogram_underline;
+		constexpr SequenceView double_right_side_line = ideogram_double_underline;
+		constexpr SequenceView         left_side_line = ideogram_overline;
+		constexpr SequenceView  double_left_side_line = ideogram_double_overline;
+		constexpr SequenceView          not_side_line = not_ideogram;
 	}
 }
 
@@ -710,16 +1202,16 @@ namespace dye {
 		namespace IndependentControlFunctions {
 			// The control sequences set of control functions is specified in §5.5, pp. 12-13
 
-			const std::string DMI  = C0::ESC + "`"; // Disable Manual Input      §8.3.34
-			const std::string INT  = C0::ESC + "a"; // Escape                    §8.3.68
-			const std::string EMI  = C0::ESC + "b"; // Enable Manual Input       §8.3.43
-			const std::string RIS  = C0::ESC + "c"; // Reset to Initial State    §8.3.105
-			const std::string CMD  = C0::ESC + "d"; // Coding Method Delimiter   §8.3.11
-			const std::string LS2  = C0::ESC + "n"; // Locking-Shift Two         §8.3.78
-			const std::string LS3  = C0::ESC + "o"; // Locking-Shift Three       §8.3.80
-			const std::string LS3R = C0::ESC + "|"; // Locking-Shift Three Right §8.3.81
-			const std::string LS2R = C0::ESC + "}"; // Locking-Shift Two Right   §8.3.79
-			const std::string LS1R = C0::ESC + "~"; // Locking-Shift One Right   §8.3.77
+			constexpr SequenceView DMI  = "\x1b" "`";  // Disable Manual Input      §8.3.34
+			constexpr SequenceView INT  = "\x1b" "a";  // Escape                    §8.3.68
+			constexpr SequenceView EMI  = "\x1b" "b";  // Enable Manual Input       §8.3.43
+			constexpr SequenceView RIS  = "\x1b" "c";  // Reset to Initial State    §8.3.105
+			constexpr SequenceView CMD  = "\x1b" "d";  // Coding Method Delimiter   §8.3.11
+			constexpr SequenceView LS2  = "\x1b" "n";  // Locking-Shift Two         §8.3.78
+			constexpr SequenceView LS3  = "\x1b" "o";  // Locking-Shift Three       §8.3.80
+			constexpr SequenceView LS3R = "\x1b" "|";  // Locking-Shift Three Right §8.3.81
+			constexpr SequenceView LS2R = "\x1b" "}";  // Locking-Shift Two Right   §8.3.79
+			constexpr SequenceView LS1R = "\x1b" "~";  // Locking-Shift One Right   §8.3.77
 		}
 	}
 }
@@ -735,7 +1227,7 @@ namespace dye {
 
 			const size_t DELIMITER_LENGTH = C1::LENGTH;
 
-			inline bool is_opening_delimiter(const std::string& s) {
+			inline bool is_opening_delimiter(const SequenceView& s) {
 				return s == C1::APC
 				    || s == C1::DCS
 				    || s == C1::OSC
@@ -743,17 +1235,23 @@ namespace dye {
 				    || s == C1::SOS;
 			}
 
+			inline bool is_opening_delimiter(const std::string& s) {
+				return is_opening_delimiter(SequenceView(s.data(), s.size()));
+			}
+
 			inline bool is_command_string_character(const char c) {
 				return (c >= '\x08' && c <= '\x0d')
 				    || (c >= '\x20' && c <= '\x7e');
 			}
 
 
+			// Command strings consist of bit combinations 00/08 to 00/13 and 02/00 to
+			// 07/14 (§5.6 a)
 			inline
 			bool is_command_string(const std::string::const_iterator& begin,
 			                       const std::string::const_iterator& end) {
 				for (std::string::const_iterator c = begin ; c != end ; ++c) {
-					if (is_command_string_character(*c)) return false;
+					if (!is_command_string_character(*c)) return false;
 				}
 
 				return true;
@@ -763,28 +1261,34 @@ namespace dye {
 				return is_command_string(s.begin(), s.end());
 			}
 
+			// Character strings consist of any bit combinations except those
+			// representing SOS or ST (§5.6 b)
 			inline
 			bool is_character_string(const std::string::const_iterator& begin,
 			                         const std::string::const_iterator& end) {
-				static const std::string not_character_string = C1::SOS + C1::ST;
-				return std::find_first_of(begin,
-				                          end,
-				                          not_character_string.begin(),
-				                          not_character_string.end()) == end;
+				for (std::string::const_iterator c = std::find(begin, end, '\x1b') ; c != end ; c = std::find(c + 1, end, '\x1b')) {
+					if (c + 1 != end && (c[1] == C1::SOS[1] || c[1] == C1::ST[1])) return false;
+				}
+
+				return true;
 			}
 
 			inline bool is_character_string(const std::string& s) {
-				return s.find_first_of(C1::SOS + C1::ST) == std::string::npos;
+				return is_character_string(s.begin(), s.end());
 			}
 
+			// An opening delimiter, a command string, or a character string after SOS,
+			// and ST
 			inline bool is_control_string(const std::string& s) {
-				return s.size() >= 2 * C1::LENGTH
-				    && s.substr(0, DELIMITER_LENGTH) == C1::SOS
-				    && s.substr(s.size() - DELIMITER_LENGTH, DELIMITER_LENGTH) == C1::ST
-				    && (is_character_string(s.begin() + DELIMITER_LENGTH,
-				                            s.end()   - DELIMITER_LENGTH)
-				     || is_command_string(s.begin() + DELIMITER_LENGTH,
-				                          s.end()   - DELIMITER_LENGTH));
+				if (s.size() < 2 * DELIMITER_LENGTH) return false;
+				const SequenceView opening(s.data(), DELIMITER_LENGTH);
+				const SequenceView closing(s.data() + s.size() - DELIMITER_LENGTH, DELIMITER_LENGTH);
+				if (!is_opening_delimiter(opening) || closing != C1::ST) return false;
+
+				const std::string::const_iterator begin = s.begin() + DELIMITER_LENGTH;
+				const std::string::const_iterator end   = s.end()   - DELIMITER_LENGTH;
+				return is_command_string(begin, end)
+				    || (opening == C1::SOS && is_character_string(begin, end));
 			}
 
 			inline std::string APC(const std::string& s) { return C1::APC + s + C1::ST; }
@@ -797,84 +1301,677 @@ namespace dye {
 }
 
 // –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
-//                                  RGB model                                 //
+//                              ECMA-48 Tokenizer                             //
 // –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
 
 namespace dye {
-	class RGB {
-		public:
-			float r,g,b;
+	namespace ECMA48 {
+		// ––––––––––––––––
+		// Helper functions
 
-			RGB(float r, float g, float b)
-				: r(r), g(g), b(b)
-				{}
+		namespace {
+			inline bool is_c0(char c) {
+				return static_cast<unsigned char>(c) < 0x20;
+			}
 
-			RGB operator*(float m) {
-				return RGB(r*m, g*m, b*m);
+#ifdef __SSE2__
+			// Whether one of the 16 bytes at p is a C0 control: unsigned bytes equal
+			// to their minimum with 01/15
+			inline bool sse2_has_c0(const char* p) {
+				const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				const __m128i c0 = _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(0x1F)), bytes);
+				return _mm_movemask_epi8(c0) != 0;
 			}
+#endif
 
-			// From https://en.wikipedia.org/wiki/HSL_and_HSV#From_HSV
-			static RGB fromHSV(float H, float S, float V) {
-				assert(H >= 0.0f && H <= 360.0f);
-				assert(S >= 0.0f && S <= 1.0f);
-				assert(V >= 0.0f && V <= 1.0f);
+			// First C0 control of [p, end), or end
+			inline const char* find_c0(const char* p, const char* end) {
+#ifdef __SSE2__
+				while (end - p >= 16 && !sse2_has_c0(p)) p += 16;
+#endif
+				while (p != end && !is_c0(*p)) ++p;
+				return p;
+			}
+		}
 
-				const float C = V * S;
-				const float HH = H / 60.0f;
-				const float X = C * (1.0f - std::abs(std::fmod(HH, 2) - 1));
-				const float m = V - C;
+		// ––––––––––––––––
+		// Public interface
 
-				float R1 = 0.0f, G1 = 0.0f, B1 = 0.0f;
-				if      (HH >= 0.0f && HH < 1.0f) R1 = C,    G1 = X,    B1 = 0.0f;
-				else if (HH >= 1.0f && HH < 2.0f) R1 = X,    G1 = C,    B1 = 0.0f;
-				else if (HH >= 2.0f && HH < 3.0f) R1 = 0.0f, G1 = C,    B1 = X;
-				else if (HH >= 3.0f && HH < 4.0f) R1 = 0.0f, G1 = X,    B1 = C;
-				else if (HH >= 4.0f && HH < 5.0f) R1 = X,    G1 = 0.0f, B1 = C;
-				else if (HH >= 5.0f && HH < 6.0f) R1 = C,    G1 = 0.0f, B1 = X;
+		// Unit of ECMA-48 encoded bytes. Views point into the chunk being tokenized,
+		// or into the tokenizer for sequences split across chunks, and are only
+		// valid during the callback receiving the token.
+		struct Token {
+			enum Kind {
+				TEXT,             // Run of bytes other than C0 controls
+				C0_CONTROL,       // C0 control other than ESC (§5.2)
+				C1_CONTROL,       // ESC Fe, other than CSI and opening delimiters (§5.3)
+				ESCAPE_SEQUENCE,  // ESC, intermediate bytes, and a final byte (§5.3, §5.5)
+				CONTROL_SEQUENCE, // CSI, parameter bytes, intermediate bytes, final byte (§5.4)
+				CONTROL_STRING,   // Piece of the contents of a control string (§5.6)
+				INVALID           // Sequence cut short by an unexpected byte
+			};
 
-				return RGB(R1 + m,
-				           G1 + m,
-				           B1 + m) * 255.0f;
+			static const size_t MAX_PARAMETERS = 32;
+
+			Kind kind;
+
+			// Bytes of the token. For control strings, bytes of the contents without
+			// delimiters, given in as many pieces as it takes.
+			SequenceView bytes;
+
+			// Final byte of C1 controls, escape sequences and control sequences,
+			// the byte of C0 controls, and the final byte of the opening delimiter
+			// of control strings, e.g. ']' for OSC
+			char function;
+
+			// Control sequences: private parameter string marker, 03/12 to 03/15
+			// (§5.4.1 b), intermediate bytes and parameters. Parameters are
+			// separated by ';', or by ':' for sub-parameters, whose bit is then set
+			// in subparameters. Omitted parameters are 0 with their bit set in
+			// omitted (§5.4.2); values saturate at MAX_PARAMETER_VALUE.
+			char private_marker;
+			SequenceView intermediates;
+			size_t parameter_count;
+			size_t parameters[MAX_PARAMETERS];
+			uint32_t omitted;
+			uint32_t subparameters;
+
+			static const size_t MAX_PARAMETER_VALUE = 999999999;
+
+			// Control strings: whether this is the first or the last piece
+			bool is_first;
+			bool is_last;
+
+			// Parameter i, or default_value if it is omitted or absent
+			size_t parameter(size_t i, size_t default_value) const {
+				if (i >= parameter_count || (omitted >> i & 1)) return default_value;
+				return parameters[i];
 			}
+		};
+
+		// Incremental tokenizer of ECMA-48 encoded bytes, given in chunks of any
+		// size. Sequences split across chunks are resumed: their bytes are kept
+		// until they are complete, up to MAX_SEQUENCE_LENGTH bytes. Text runs and
+		// control strings are never copied; they are reported in pieces ending at
+		// chunk boundaries. Text is skipped 16 bytes at a time with SSE2.
+		//
+		//     dye::ECMA48::Tokenizer tokenizer;
+		//     while (size_t n = read(chunk))
+		//         tokenizer.feed(chunk, n, [](const dye::ECMA48::Token& token) { ... });
+		//     tokenizer.finish([](const dye::ECMA48::Token& token) { ... });
+		//
+		// A C0 control or a byte out of place ends a sequence as an INVALID token,
+		// and is then tokenized as if it were outside of it, like terminals do.
+		// Control strings end with ST, with BEL for OSC as in xterm, or with any
+		// other escape sequence; their last piece has is_last set. Text is not
+		// decoded: UTF-8 characters may be split across pieces.
+		class Tokenizer {
+			public:
+				static const size_t MAX_SEQUENCE_LENGTH = 256;
+
+				Tokenizer()
+					: state_(GROUND)
+					, pending_size_(0)
+					, has_intermediates_(false)
+					, string_function_(0)
+					, is_first_piece_(false)
+					{}
+
+				// Calls f(const Token&) for every token of the chunk, except for the
+				// sequence it ends in, if any
+				template <typename F>
+				void feed(const char* data, size_t size, F f) {
+					const char* p = data;
+					const char* const end = data + size;
+					const char* start = data; // Start of the sequence in this chunk
+					while (p != end) {
+						switch (state_) {
+							case GROUND: {
+								const char* const text_end = find_c0(p, end);
+								if (text_end != p) emit(f, Token::TEXT, SequenceView(p, text_end - p));
+								p = text_end;
+								if (p == end) break;
+								if (*p == '\x1b') {
+									start = p++;
+									state_ = ESCAPE;
+									has_intermediates_ = false;
+								} else {
+									emit(f, Token::C0_CONTROL, SequenceView(p, 1));
+									++p;
+								}
+								break;
+							}
+
+							case ESCAPE: {
+								const unsigned char c = *p;
+								if (c >= 0x20 && c <= 0x2F && length(start, p) + 1 < MAX_SEQUENCE_LENGTH) {
+									has_intermediates_ = true;
+									++p;
+								} else if (c >= 0x30 && c <= 0x7E) {
+									++p;
+									if (!has_intermediates_ && c == C1::CSI[1]) {
+										state_ = CONTROL_SEQUENCE;
+									} else if (!has_intermediates_ && is_opening_delimiter(c)) {
+										pending_size_ = 0;
+										string_function_ = c;
+										is_first_piece_ = true;
+										state_ = STRING;
+									} else {
+										const bool fe = !has_intermediates_ && c >= 0x40 && c <= 0x5F;
+										emit_sequence(f, fe ? Token::C1_CONTROL : Token::ESCAPE_SEQUENCE, start, p);
+									}
+								} else {
+									emit_sequence(f, Token::INVALID, start, p);
+								}
+								break;
+							}
+
+							case CONTROL_SEQUENCE: {
+								const unsigned char c = *p;
+								if (length(start, p) == MAX_SEQUENCE_LENGTH) {
+									emit_sequence(f, Token::INVALID, start, p);
+								} else if (c >= 0x30 && c <= 0x3F && !has_intermediates_) {
+									++p;
+								} else if (c >= 0x20 && c <= 0x2F) {
+									has_intermediates_ = true;
+									++p;
+								} else if (c >= 0x40 && c <= 0x7E) {
+									++p;
+									emit_sequence(f, Token::CONTROL_SEQUENCE, start, p);
+								} else {
+									emit_sequence(f, Token::INVALID, start, p);
+								}
+								break;
+							}
+
+							case STRING: {
+								const char* q = p;
+								for (;;) {
+									q = find_c0(q, end);
+									if (q == end || *q == '\x1b' || (*q == '\x07' && string_function_ == C1::OSC[1])) break;
+									++q;
+								}
+								if (q == end) {
+									if (q != p) emit_piece(f, p, q, false);
+								} else if (*q == '\x07') {
+									emit_piece(f, p, q, true);
+									++q;
+								} else if (q + 1 == end) {
+									// ESC, which may start ST in the next chunk
+									if (q != p) emit_piece(f, p, q, false);
+									state_ = STRING_ESCAPE;
+									++q;
+								} else if (q[1] == C1::ST[1]) {
+									emit_piece(f, p, q, true);
+									q += 2;
+								} else {
+									// Any other escape sequence ends the string
+									emit_piece(f, p, q, true);
+								}
+								p = q;
+								break;
+							}
+
+							case STRING_ESCAPE: {
+								emit_piece(f, p, p, true);
+								if (*p == C1::ST[1]) {
+									++p;
+									break;
+								}
+								// Escape sequence started by the ESC of the previous chunk
+								pending_[0] = '\x1b';
+								pending_size_ = 1;
+								start = p;
+								state_ = ESCAPE;
+								has_intermediates_ = false;
+								break;
+							}
+						}
+					}
 
-			float norm() const {
-				return std::sqrt(std::pow(r,2) + std::pow(g,2) + std::pow(b,2));
-			}
+					// Keeps the bytes of an incomplete sequence
+					if (state_ == ESCAPE || state_ == CONTROL_SEQUENCE) {
+						std::memcpy(pending_ + pending_size_, start, end - start);
+						pending_size_ += end - start;
+					}
+				}
 
-			float distance(const RGB& other) const {
-				return std::sqrt(std::pow(other.r-r,2.0f)
-				               + std::pow(other.g-g,2.0f)
-				               + std::pow(other.b-b,2.0f));
-			}
+				// Ends the input: an incomplete sequence is reported as INVALID, and the
+				// last piece of an unterminated control string is reported
+				template <typename F>
+				void finish(F f) {
+					if (state_ == ESCAPE || state_ == CONTROL_SEQUENCE)
+						emit_sequence(f, Token::INVALID, pending_ + pending_size_, pending_ + pending_size_);
+					else if (state_ == STRING || state_ == STRING_ESCAPE)
+						emit_piece(f, 0, 0, true);
+					state_ = GROUND;
+				}
 
-			float distance_to_identity_line() const {
-			    // Returns the distance of the 3D point with coordinates (r,g,b) to the r=g=b line.
-			    // Simplification of http://mathworld.wolfram.com/Point-LineDistance3-Dimensional.html
-			    return std::sqrt(std::pow(b-g,2.0f) + std::pow(b-r,2.0f) + std::pow(g-r,2.0f))
-			         / std::sqrt(3.0f);
-			}
+				// Whether the tokenizer is between tokens
+				bool is_ground() const { return state_ == GROUND; }
 
-			float distance_along_identity_line() const {
-				return std::sqrt(std::pow(norm(),2.0f) - std::pow(distance_to_identity_line(),2.0f));
-			}
+			private:
+				enum State { GROUND, ESCAPE, CONTROL_SEQUENCE, STRING, STRING_ESCAPE };
 
-			RGB projection_on_identity_line() const {
-				const float d = distance_along_identity_line();
-				return RGB(d,d,d);
-			}
+				static bool is_opening_delimiter(unsigned char c) {
+					return c == C1::APC[1] || c == C1::DCS[1] || c == C1::OSC[1]
+					    || c == C1::PM[1]  || c == C1::SOS[1];
+				}
 
-		private:
-			bool _valid() const {
-				return (r>=0.0f && r<=255.0f) &&
-				       (g>=0.0f && g<=255.0f) &&
-				       (b>=0.0f && b<=255.0f);
-			}
-	};
+				// Bytes of the current sequence, from its start in a previous chunk or
+				// at start
+				size_t length(const char* start, const char* p) const {
+					return pending_size_ + (p - start);
+				}
 
-	inline
-	std::ostream& operator<<(std::ostream& stream, const RGB& rgb) {
-		stream << "(" << rgb.r << "," << rgb.g << "," << rgb.b << ")";
-		return stream;
+				template <typename F>
+				void emit(F& f, Token::Kind kind, const SequenceView& bytes) {
+					token_.kind = kind;
+					token_.bytes = bytes;
+					token_.function = bytes[bytes.size() - 1];
+					f(static_cast<const Token&>(token_));
+				}
+
+				// Reports the sequence ending at p, and returns to the ground state
+				template <typename F>
+				void emit_sequence(F& f, Token::Kind kind, const char* start, const char* p) {
+					const char* data = start;
+					if (pending_size_ != 0) {
+						std::memcpy(pending_ + pending_size_, start, p - start);
+						pending_size_ += p - start;
+						data = pending_;
+						p = pending_ + pending_size_;
+					}
+					state_ = GROUND;
+					pending_size_ = 0;
+					if (p == data) return;
+
+					token_.kind = kind;
+					token_.bytes = SequenceView(data, p - data);
+					token_.function = p[-1];
+					token_.intermediates = SequenceView();
+					token_.parameter_count = 0;
+					token_.omitted = token_.subparameters = 0;
+					token_.private_marker = 0;
+					if (kind == Token::ESCAPE_SEQUENCE)
+						token_.intermediates = SequenceView(data + 1, p - data - 2);
+					else if (kind == Token::CONTROL_SEQUENCE)
+						parse_control_sequence(data + C1::LENGTH, p - 1);
+					f(static_cast<const Token&>(token_));
+				}
+
+				template <typename F>
+				void emit_piece(F& f, const char* p, const char* q, bool is_last) {
+					token_.kind = Token::CONTROL_STRING;
+					token_.bytes = SequenceView(p != 0 ? p : "", q - p);
+					token_.function = string_function_;
+					token_.is_first = is_first_piece_;
+					token_.is_last = is_last;
+					is_first_piece_ = false;
+					if (is_last) state_ = GROUND;
+					f(static_cast<const Token&>(token_));
+				}
+
+				// Parameter and intermediate bytes [p, end) of a control sequence
+				void parse_control_sequence(const char* p, const char* end) {
+					const char* intermediates = p;
+					while (intermediates != end && static_cast<unsigned char>(*intermediates) >= 0x30) ++intermediates;
+					token_.intermediates = SequenceView(intermediates, end - intermediates);
+
+					if (p != intermediates && *p >= '<') token_.private_marker = *p++;
+					if (p == intermediates) return;
+
+					size_t value = 0;
+					bool is_omitted = true;
+					bool is_subparameter = false;
+					for (;; ++p) {
+						if (p != intermediates && *p >= '0' && *p <= '9') {
+							value = std::min(value * 10 + (*p - '0'), size_t(Token::MAX_PARAMETER_VALUE));
+							is_omitted = false;
+							continue;
+						}
+						// Other parameter bytes are reserved, and ignored
+						if (p != intermediates && *p != ';' && *p != ':') continue;
+						const size_t i = token_.parameter_count;
+						if (i < Token::MAX_PARAMETERS) {
+							token_.parameters[i] = value;
+							token_.omitted |= uint32_t(is_omitted) << i;
+							token_.subparameters |= uint32_t(is_subparameter) << i;
+							token_.parameter_count = i + 1;
+						}
+						if (p == intermediates) return;
+						is_subparameter = *p == ':';
+						value = 0;
+						is_omitted = true;
+					}
+				}
+
+				State state_;
+				Token token_;
+
+				// Bytes of a sequence started in a previous chunk
+				char pending_[MAX_SEQUENCE_LENGTH];
+				size_t pending_size_;
+				bool has_intermediates_;
+
+				// Control string being tokenized
+				char string_function_;
+				bool is_first_piece_;
+		};
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                  Stripping                                 //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ––––––––––––––––
+	// Helper functions
+
+	namespace {
+		// Lead byte of the UTF-8 encodings of C1 controls, U+0080 to U+009F
+		const unsigned char C1_LEAD_BYTE = 0xC2;
+
+		inline bool is_escape_or_c1_lead(char c) {
+			return c == '\x1b' || static_cast<unsigned char>(c) == C1_LEAD_BYTE;
+		}
+
+		inline bool is_c1_continuation(char c) {
+			return static_cast<unsigned char>(c) >= 0x80 && static_cast<unsigned char>(c) <= 0x9F;
+		}
+
+#ifdef __SSE2__
+		// Whether one of the 32 bytes at p is ESC or C1_LEAD_BYTE
+		inline bool sse2_has_escape_or_c1_lead(const char* p) {
+			const __m128i escape = _mm_set1_epi8('\x1b');
+			const __m128i lead = _mm_set1_epi8(static_cast<char>(C1_LEAD_BYTE));
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+			const __m128i found = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(a, escape), _mm_cmpeq_epi8(a, lead)),
+				_mm_or_si128(_mm_cmpeq_epi8(b, escape), _mm_cmpeq_epi8(b, lead)));
+			return _mm_movemask_epi8(found) != 0;
+		}
+#endif
+
+		// First ESC or C1_LEAD_BYTE of [p, end), or end
+		inline const char* find_escape_or_c1_lead(const char* p, const char* end) {
+#ifdef __SSE2__
+			while (end - p >= 32 && !sse2_has_escape_or_c1_lead(p)) p += 32;
+#endif
+			while (p != end && !is_escape_or_c1_lead(*p)) ++p;
+			return p;
+		}
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// Stripper removes ECMA-48 control functions from bytes given in chunks of
+	// any size: escape sequences, C1 controls in their 7-bit form or encoded in
+	// UTF-8, control sequences and control strings, as well as sequences cut
+	// short. UTF-8 encoded C1 controls are tokenized as their 7-bit form, so
+	// that CSI, DCS, OSC, PM, APC and SOS open sequences and strings, and ST
+	// ends them. Text and C0 controls other than ESC, e.g. newlines and tabs,
+	// are kept. Runs of bytes without ESC or 0xC2 are found 32 bytes at a time
+	// with SSE2 and passed on without further inspection; the rest goes through
+	// an ECMA48::Tokenizer.
+	//
+	// Kept bytes are given to write(const char* data, size_t size), in pieces.
+	class Stripper {
+		public:
+			static const size_t CLEAN_BLOCK_SIZE = 16 * 1024;
+
+			Stripper()
+				: has_c1_lead_(false)
+				{}
+
+			template <typename F>
+			void feed(const char* data, size_t size, F write) {
+				const char* p = data;
+				const char* const end = data + size;
+				if (has_c1_lead_ && p != end) {
+					// Lead byte at the end of the previous chunk
+					has_c1_lead_ = false;
+					if (is_c1_continuation(*p)) tokenize_c1(*p++, write);
+					else tokenize(reinterpret_cast<const char*>(&C1_LEAD_BYTE), 1, write);
+				}
+
+				while (p != end) {
+					if (tokenizer_.is_ground()) {
+						// Clean text is passed on in blocks, still cached when write() copies
+						// them
+						const char* const block_end = size_t(end - p) > CLEAN_BLOCK_SIZE ? p + CLEAN_BLOCK_SIZE : end;
+						const char* const text_end = find_escape_or_c1_lead(p, block_end);
+						if (text_end != p) write(p, text_end - p);
+						p = text_end;
+						if (p == block_end) continue;
+					}
+
+					if (static_cast<unsigned char>(*p) == C1_LEAD_BYTE) {
+						if (p + 1 == end) {
+							has_c1_lead_ = true;
+							break;
+						}
+						if (is_c1_continuation(p[1])) {
+							tokenize_c1(p[1], write);
+							p += 2;
+							continue;
+						}
+					}
+
+					// Escape sequence, or text or the contents of a sequence, up to the
+					// next one
+					const char* const next = find_escape_or_c1_lead(p + 1, end);
+					tokenize(p, next - p, write);
+					p = next;
+				}
+			}
+
+			// Ends the input, dropping an incomplete sequence
+			template <typename F>
+			void finish(F write) {
+				if (has_c1_lead_) tokenize(reinterpret_cast<const char*>(&C1_LEAD_BYTE), 1, write);
+				has_c1_lead_ = false;
+				tokenizer_.finish([](const ECMA48::Token&) {});
+			}
+
+			// Whether the last chunk ended outside a control function
+			bool is_ground() const { return !has_c1_lead_ && tokenizer_.is_ground(); }
+
+		private:
+			template <typename F>
+			void tokenize(const char* data, size_t size, F& write) {
+				tokenizer_.feed(data, size, [&write](const ECMA48::Token& token) {
+					if (token.kind == ECMA48::Token::TEXT || token.kind == ECMA48::Token::C0_CONTROL)
+						write(token.bytes.data(), token.bytes.size());
+				});
+			}
+
+			// C1 control of the given UTF-8 continuation byte, as ESC Fe
+			template <typename F>
+			void tokenize_c1(char continuation, F& write) {
+				const char sequence[ECMA48::C1::LENGTH] = { '\x1b', char(continuation - 0x40) };
+				tokenize(sequence, ECMA48::C1::LENGTH, write);
+			}
+
+			ECMA48::Tokenizer tokenizer_;
+			bool has_c1_lead_; // The last chunk ended with C1_LEAD_BYTE
+	};
+
+	// Appends the text of [data, data+size) to out, without control functions
+	inline void strip(std::string& out, const char* data, size_t size) {
+		out.reserve(out.size() + size);
+		Stripper stripper;
+		stripper.feed(data, size, [&out](const char* text, size_t length) { out.append(text, length); });
+		stripper.finish([&out](const char* text, size_t length) { out.append(text, length); });
+	}
+
+	inline std::string strip(const char* data, size_t size) {
+		std::string out;
+		strip(out, data, size);
+		return out;
+	}
+
+	inline std::string strip(const std::string& s) {
+		return strip(s.data(), s.size());
+	}
+
+	// Output stream buffer stripping control functions from what is written to
+	// it before passing it to another stream buffer, e.g. to store colored
+	// output in a file:
+	//
+	//     std::ofstream file("build.log");
+	//     dye::StrippingBuffer buffer(file.rdbuf());
+	//     std::ostream log(&buffer);
+	//     log << dye::red("error") << '\n'; // Writes "error\n"
+	//
+	// Writes of at least BUFFER_SIZE bytes are stripped without being copied.
+	// Incomplete sequences are dropped when the buffer is destroyed.
+	class StrippingBuffer : public std::streambuf {
+		public:
+			static const size_t BUFFER_SIZE = 4096;
+
+			explicit StrippingBuffer(std::streambuf* destination)
+				: destination_(destination)
+				, failed_(false)
+				{
+					setp(buffer_, buffer_ + BUFFER_SIZE);
+				}
+
+			~StrippingBuffer() {
+				sync();
+				stripper_.finish(Write(this));
+			}
+
+			StrippingBuffer(const StrippingBuffer&) = delete;
+			StrippingBuffer& operator=(const StrippingBuffer&) = delete;
+
+		protected:
+			int_type overflow(int_type c) override {
+				if (!strip_buffer()) return traits_type::eof();
+				if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+				return c;
+			}
+
+			std::streamsize xsputn(const char* s, std::streamsize n) override {
+				if (size_t(n) < BUFFER_SIZE) return std::streambuf::xsputn(s, n);
+				if (!strip_buffer()) return 0;
+				stripper_.feed(s, n, Write(this));
+				return failed_ ? 0 : n;
+			}
+
+			int sync() override {
+				if (!strip_buffer()) return -1;
+				return destination_->pubsync();
+			}
+
+		private:
+			struct Write {
+				explicit Write(StrippingBuffer* buffer) : buffer(buffer) {}
+				void operator()(const char* data, size_t size) const {
+					if (buffer->destination_->sputn(data, size) != std::streamsize(size))
+						buffer->failed_ = true;
+				}
+				StrippingBuffer* buffer;
+			};
+
+			// Strips the buffered bytes, and returns false if writing failed
+			bool strip_buffer() {
+				stripper_.feed(pbase(), pptr() - pbase(), Write(this));
+				setp(buffer_, buffer_ + BUFFER_SIZE);
+				return !failed_;
+			}
+
+			std::streambuf* destination_;
+			Stripper stripper_;
+			bool failed_;
+			char buffer_[BUFFER_SIZE];
+	};
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                  RGB model                                 //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	class RGB {
+		public:
+			float r,g,b;
+
+			RGB(float r, float g, float b)
+				: r(r), g(g), b(b)
+				{}
+
+			RGB operator*(float m) {
+				return RGB(r*m, g*m, b*m);
+			}
+
+			// From https://en.wikipedia.org/wiki/HSL_and_HSV#From_HSV
+			static RGB fromHSV(float H, float S, float V) {
+				assert(H >= 0.0f && H <= 360.0f);
+				assert(S >= 0.0f && S <= 1.0f);
+				assert(V >= 0.0f && V <= 1.0f);
+
+				const float C = V * S;
+				const float HH = H / 60.0f;
+				const float X = C * (1.0f - std::abs(std::fmod(HH, 2) - 1));
+				const float m = V - C;
+
+				float R1 = 0.0f, G1 = 0.0f, B1 = 0.0f;
+				if      (HH >= 0.0f && HH < 1.0f) R1 = C,    G1 = X,    B1 = 0.0f;
+				else if (HH >= 1.0f && HH < 2.0f) R1 = X,    G1 = C,    B1 = 0.0f;
+				else if (HH >= 2.0f && HH < 3.0f) R1 = 0.0f, G1 = C,    B1 = X;
+				else if (HH >= 3.0f && HH < 4.0f) R1 = 0.0f, G1 = X,    B1 = C;
+				else if (HH >= 4.0f && HH < 5.0f) R1 = X,    G1 = 0.0f, B1 = C;
+				else if (HH >= 5.0f && HH < 6.0f) R1 = C,    G1 = 0.0f, B1 = X;
+
+				return RGB(R1 + m,
+				           G1 + m,
+				           B1 + m) * 255.0f;
+			}
+
+			float norm() const {
+				return std::sqrt(std::pow(r,2) + std::pow(g,2) + std::pow(b,2));
+			}
+
+			float distance(const RGB& other) const {
+				return std::sqrt(std::pow(other.r-r,2.0f)
+				               + std::pow(other.g-g,2.0f)
+				               + std::pow(other.b-b,2.0f));
+			}
+
+			float distance_to_identity_line() const {
+			    // Returns the distance of the 3D point with coordinates (r,g,b) to the r=g=b line.
+			    // Simplification of http://mathworld.wolfram.com/Point-LineDistance3-Dimensional.html
+			    return std::sqrt(std::pow(b-g,2.0f) + std::pow(b-r,2.0f) + std::pow(g-r,2.0f))
+			         / std::sqrt(3.0f);
+			}
+
+			float distance_along_identity_line() const {
+				return std::sqrt(std::pow(norm(),2.0f) - std::pow(distance_to_identity_line(),2.0f));
+			}
+
+			RGB projection_on_identity_line() const {
+				const float d = distance_along_identity_line();
+				return RGB(d,d,d);
+			}
+
+		private:
+			bool _valid() const {
+				return (r>=0.0f && r<=255.0f) &&
+				       (g>=0.0f && g<=255.0f) &&
+				       (b>=0.0f && b<=255.0f);
+			}
+	};
+
+	inline
+	std::ostream& operator<<(std::ostream& stream, const RGB& rgb) {
+		stream << "(" << rgb.r << "," << rgb.g << "," << rgb.b << ")";
+		return stream;
 	}
 }
 
@@ -925,25 +2022,25 @@ namespace dye {
 
 		// RGB space structure
 
-		const float RGB_EXTENT = 255.0f;
+		constexpr float RGB_EXTENT = 255.0f;
 
-		const float SECOND_EXTENDED_VALUE = 95.0f;
-		const float EXTENDED_STEP = (RGB_EXTENT - SECOND_EXTENDED_VALUE) / (EXTENDED_LEVELS - 2);
+		constexpr float SECOND_EXTENDED_VALUE = 95.0f;
+		constexpr float EXTENDED_STEP = (RGB_EXTENT - SECOND_EXTENDED_VALUE) / (EXTENDED_LEVELS - 2);
 
-		const float FIRST_GREY_VALUE = 8.0f;
-		const float  LAST_GREY_VALUE = 238.0f;
-		const float GREY_EXTENT = LAST_GREY_VALUE - FIRST_GREY_VALUE;
-		const float GREY_STEP = GREY_EXTENT / (GREY_LEVELS - 1);
+		constexpr float FIRST_GREY_VALUE = 8.0f;
+		constexpr float  LAST_GREY_VALUE = 238.0f;
+		constexpr float GREY_EXTENT = LAST_GREY_VALUE - FIRST_GREY_VALUE;
+		constexpr float GREY_STEP = GREY_EXTENT / (GREY_LEVELS - 1);
 
 		// ·················
 		// Utility functions
 
 		namespace {
-			const float _UNIT_CUBE_DIAGONAL = std::sqrt(3.0f);
-			const float  _RGB_CUBE_DIAGONAL = RGB_EXTENT * _UNIT_CUBE_DIAGONAL;
-			const float _GREY_CUBE_DIAGONAL_STEP = GREY_EXTENT * _UNIT_CUBE_DIAGONAL / (GREY_LEVELS - 1);
-			const float _FIRST_GREY_DIAGONAL_VALUE = FIRST_GREY_VALUE * _UNIT_CUBE_DIAGONAL;
-			const float  _LAST_GREY_DIAGONAL_VALUE =  LAST_GREY_VALUE * _UNIT_CUBE_DIAGONAL;
+			constexpr float _UNIT_CUBE_DIAGONAL = 1.7320508075688772f; // sqrt(3)
+			constexpr float  _RGB_CUBE_DIAGONAL = RGB_EXTENT * _UNIT_CUBE_DIAGONAL;
+			constexpr float _GREY_CUBE_DIAGONAL_STEP = GREY_EXTENT * _UNIT_CUBE_DIAGONAL / (GREY_LEVELS - 1);
+			constexpr float _FIRST_GREY_DIAGONAL_VALUE = FIRST_GREY_VALUE * _UNIT_CUBE_DIAGONAL;
+			constexpr float  _LAST_GREY_DIAGONAL_VALUE =  LAST_GREY_VALUE * _UNIT_CUBE_DIAGONAL;
 
 			inline int round(float x) {
 				assert(x >= 0.0f);
@@ -987,6 +2084,57 @@ namespace dye {
 			}
 		}
 
+		// ···························
+		// Integer nearest-color search
+
+		// All xterm256 channel values are integers: extended values are 0 then
+		// 95 + 40*(l-1), grey values are 8 + 10*l. For integer inputs, nearest
+		// levels can be found with integer comparisons and distances compared
+		// squared, exactly.
+
+		namespace {
+			const size_t SECOND_EXTENDED_CHANNEL = 95;
+			const size_t EXTENDED_CHANNEL_STEP = 40;
+			const size_t FIRST_GREY_CHANNEL = 8;
+			const size_t GREY_CHANNEL_STEP = 10;
+
+			// Level of the extended value nearest to v, with halfway values rounded up
+			// as in extended_level_from_extended_value()
+			inline size_t extended_level_from_channel(size_t v) {
+				return (v >  47) + (v > 115) + (v > 154)
+				     + (v > 194) + (v > 234);
+			}
+
+			inline size_t extended_value_from_level(size_t l) {
+				return l == 0 ? 0 : SECOND_EXTENDED_CHANNEL + (l-1) * EXTENDED_CHANNEL_STEP;
+			}
+
+			// Grey level nearest to (r,g,b) along the identity line, i.e. the level
+			// nearest to the mean of the channels: round((sum-24)/30), halfway rounded up
+			inline size_t grey_level_from_sum(size_t sum) {
+				if (sum <= 3 * FIRST_GREY_CHANNEL) return 0;
+				const size_t l = (sum - 3 * FIRST_GREY_CHANNEL + 3 * GREY_CHANNEL_STEP / 2)
+				               / (3 * GREY_CHANNEL_STEP);
+				return l < GREY_LEVELS ? l : GREY_LEVELS - 1;
+			}
+
+			// Whether the mean of the channels is exactly halfway between two grey
+			// levels. Both are then at the same distance, and the floating-point
+			// closest_grey_level_from_RGB() picks either depending on rounding.
+			inline bool is_halfway_grey_sum(size_t sum) {
+				return sum > 3 * FIRST_GREY_CHANNEL
+				    && (sum - 3 * FIRST_GREY_CHANNEL + 3 * GREY_CHANNEL_STEP / 2) % (3 * GREY_CHANNEL_STEP) == 0;
+			}
+
+			inline size_t squared_distance(size_t r1, size_t g1, size_t b1,
+			                               size_t r2, size_t g2, size_t b2) {
+				const long dr = long(r1) - long(r2);
+				const long dg = long(g1) - long(g2);
+				const long db = long(b1) - long(b2);
+				return dr*dr + dg*dg + db*db;
+			}
+		}
+
 		// ––––––––––––––––
 		// Public interface
 
@@ -1026,152 +2174,393 @@ namespace dye {
 			return ECMA48_from_extended_levels(levels.r, levels.g, levels.b);
 		}
 
-		inline size_t ECMA48_from_rgb(size_t r, size_t g, size_t b) {
-			const RGB rgb(r,g,b);
+		// Floating-point definition of ECMA48_from_rgb(), which the integer search
+		// must match exactly, as checked for all colors by tests/xterm256_exact.cpp
+		namespace {
+			inline size_t reference_ECMA48_from_rgb(size_t r, size_t g, size_t b) {
+				const RGB rgb(r,g,b);
+
+				const ExtendedLevels closest_extended_levels = closest_extended_levels_from_RGB(rgb);
+				const RGB closest_extended = rgb_from_extended_levels(closest_extended_levels);
 
-			const ExtendedLevels closest_extended_levels = closest_extended_levels_from_RGB(rgb);
-			const RGB closest_extended = rgb_from_extended_levels(closest_extended_levels);
+				const size_t closest_grey_level = closest_grey_level_from_RGB(rgb);
+				const RGB closest_grey = rgb_from_grey_level(closest_grey_level);
 
-			const size_t closest_grey_level = closest_grey_level_from_RGB(rgb);
-			const RGB closest_grey = rgb_from_grey_level(closest_grey_level);
+				if (rgb.distance(closest_grey) < rgb.distance(closest_extended)) {
+					return ECMA48_from_grey_level(closest_grey_level);
+				} else {
+					return ECMA48_from_extended_levels(closest_extended_levels);
+				}
+			}
+		}
 
-			if (rgb.distance(closest_grey) < rgb.distance(closest_extended)) {
-				return ECMA48_from_grey_level(closest_grey_level);
+		inline size_t ECMA48_from_rgb(size_t r, size_t g, size_t b) {
+			assert(r <= 255);
+			assert(g <= 255);
+			assert(b <= 255);
+
+			const size_t rl = extended_level_from_channel(r);
+			const size_t gl = extended_level_from_channel(g);
+			const size_t bl = extended_level_from_channel(b);
+			const size_t de2 = squared_distance(r, g, b, extended_value_from_level(rl),
+			                                             extended_value_from_level(gl),
+			                                             extended_value_from_level(bl));
+
+			const size_t sum = r + g + b;
+			const size_t grey_level = grey_level_from_sum(sum);
+			const size_t grey_value = FIRST_GREY_CHANNEL + grey_level * GREY_CHANNEL_STEP;
+			const size_t dg2 = squared_distance(r, g, b, grey_value, grey_value, grey_value);
+
+			if (dg2 < de2) {
+				// Match the reference's choice between two equidistant grey levels
+				if (is_halfway_grey_sum(sum))
+					return ECMA48_from_grey_level(closest_grey_level_from_RGB(RGB(r,g,b)));
+				return ECMA48_from_grey_level(grey_level);
 			} else {
-				return ECMA48_from_extended_levels(closest_extended_levels);
+				return ECMA48_from_extended_levels(rl, gl, bl);
+			}
+		}
+
+		// ················
+		// Batch conversion
+
+#ifdef __SSE2__
+		// ECMA48_from_rgb() on 8 pixels at once, in 16-bit lanes. Squared distances
+		// need up to 18 bits and are compared in 32-bit lanes.
+		namespace {
+			inline __m128i sse2_extended_level(__m128i v) {
+				__m128i l = _mm_setzero_si128();
+				l = _mm_sub_epi16(l, _mm_cmpgt_epi16(v, _mm_set1_epi16( 47)));
+				l = _mm_sub_epi16(l, _mm_cmpgt_epi16(v, _mm_set1_epi16(115)));
+				l = _mm_sub_epi16(l, _mm_cmpgt_epi16(v, _mm_set1_epi16(154)));
+				l = _mm_sub_epi16(l, _mm_cmpgt_epi16(v, _mm_set1_epi16(194)));
+				l = _mm_sub_epi16(l, _mm_cmpgt_epi16(v, _mm_set1_epi16(234)));
+				return l;
+			}
+
+			inline __m128i sse2_extended_value(__m128i l) {
+				const __m128i v = _mm_add_epi16(_mm_set1_epi16(SECOND_EXTENDED_CHANNEL - EXTENDED_CHANNEL_STEP),
+				                                _mm_mullo_epi16(l, _mm_set1_epi16(EXTENDED_CHANNEL_STEP)));
+				return _mm_and_si128(v, _mm_cmpgt_epi16(l, _mm_setzero_si128()));
+			}
+
+			// Mask of the lanes where squared distance a is below squared distance b,
+			// for channel differences (ar,ag,ab) and (br,bg,bb)
+			inline __m128i sse2_is_closer(__m128i ar, __m128i ag, __m128i ab,
+			                              __m128i br, __m128i bg, __m128i bb) {
+				const __m128i zero = _mm_setzero_si128();
+				__m128i rg, b;
+
+				rg = _mm_unpacklo_epi16(ar, ag); b = _mm_unpacklo_epi16(ab, zero);
+				const __m128i a_lo = _mm_add_epi32(_mm_madd_epi16(rg, rg), _mm_madd_epi16(b, b));
+				rg = _mm_unpackhi_epi16(ar, ag); b = _mm_unpackhi_epi16(ab, zero);
+				const __m128i a_hi = _mm_add_epi32(_mm_madd_epi16(rg, rg), _mm_madd_epi16(b, b));
+				rg = _mm_unpacklo_epi16(br, bg); b = _mm_unpacklo_epi16(bb, zero);
+				const __m128i b_lo = _mm_add_epi32(_mm_madd_epi16(rg, rg), _mm_madd_epi16(b, b));
+				rg = _mm_unpackhi_epi16(br, bg); b = _mm_unpackhi_epi16(bb, zero);
+				const __m128i b_hi = _mm_add_epi32(_mm_madd_epi16(rg, rg), _mm_madd_epi16(b, b));
+
+				return _mm_packs_epi32(_mm_cmplt_epi32(a_lo, b_lo), _mm_cmplt_epi32(a_hi, b_hi));
+			}
+
+			inline void sse2_ECMA48_from_rgb(const uint8_t* rgb, uint8_t* out) {
+				const __m128i r = _mm_setr_epi16(rgb[0], rgb[3], rgb[6], rgb[ 9], rgb[12], rgb[15], rgb[18], rgb[21]);
+				const __m128i g = _mm_setr_epi16(rgb[1], rgb[4], rgb[7], rgb[10], rgb[13], rgb[16], rgb[19], rgb[22]);
+				const __m128i b = _mm_setr_epi16(rgb[2], rgb[5], rgb[8], rgb[11], rgb[14], rgb[17], rgb[20], rgb[23]);
+
+				// Closest extended color
+				const __m128i rl = sse2_extended_level(r);
+				const __m128i gl = sse2_extended_level(g);
+				const __m128i bl = sse2_extended_level(b);
+
+				// Closest grey level, as in grey_level_from_sum(): with x = sum-9
+				// saturated at 0, round((sum-24)/30) is x/30, computed as (x*2185)>>16
+				// which is exact for x < 768
+				const __m128i x = _mm_subs_epu16(_mm_add_epi16(_mm_add_epi16(r, g), b),
+				                                 _mm_set1_epi16(3 * FIRST_GREY_CHANNEL - 3 * GREY_CHANNEL_STEP / 2));
+				const __m128i unclamped_grey_level = _mm_mulhi_epu16(x, _mm_set1_epi16(2185));
+				const __m128i halfway = _mm_andnot_si128(
+					_mm_cmpeq_epi16(unclamped_grey_level, _mm_setzero_si128()),
+					_mm_cmpeq_epi16(x, _mm_mullo_epi16(unclamped_grey_level, _mm_set1_epi16(3 * GREY_CHANNEL_STEP))));
+				const __m128i grey_level = _mm_min_epi16(unclamped_grey_level, _mm_set1_epi16(GREY_LEVELS - 1));
+				const __m128i grey_value = _mm_add_epi16(_mm_set1_epi16(FIRST_GREY_CHANNEL),
+				                                         _mm_mullo_epi16(grey_level, _mm_set1_epi16(GREY_CHANNEL_STEP)));
+
+				const __m128i is_grey = sse2_is_closer(
+					_mm_sub_epi16(r, grey_value), _mm_sub_epi16(g, grey_value), _mm_sub_epi16(b, grey_value),
+					_mm_sub_epi16(r, sse2_extended_value(rl)),
+					_mm_sub_epi16(g, sse2_extended_value(gl)),
+					_mm_sub_epi16(b, sse2_extended_value(bl)));
+
+				const __m128i grey_code = _mm_add_epi16(grey_level, _mm_set1_epi16(GREY_START));
+				const __m128i extended_code = _mm_add_epi16(
+					_mm_add_epi16(_mm_set1_epi16(EXTENDED_START), bl),
+					_mm_add_epi16(_mm_mullo_epi16(rl, _mm_set1_epi16(36)), _mm_mullo_epi16(gl, _mm_set1_epi16(6))));
+				const __m128i code = _mm_or_si128(_mm_and_si128(is_grey, grey_code),
+				                                  _mm_andnot_si128(is_grey, extended_code));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(code, code));
+
+				// Pixels equidistant from two grey levels go through the scalar path
+				const int scalar = _mm_movemask_epi8(_mm_and_si128(is_grey, halfway));
+				if (scalar != 0)
+					for (size_t i=0; i<8; ++i)
+						if (scalar & (1 << 2*i))
+							out[i] = ECMA48_from_rgb(rgb[3*i], rgb[3*i+1], rgb[3*i+2]);
 			}
 		}
+#endif
+
+		// Converts n pixels stored as consecutive r,g,b bytes, writing one index per
+		// pixel to out. Results are identical to ECMA48_from_rgb(r,g,b). Not an
+		// overload of it: ECMA48_from_rgb(0,0,0) would become ambiguous.
+		inline void ECMA48_from_rgb_pixels(const uint8_t* rgb, size_t n, uint8_t* out) {
+			uint8_t* const end = out + n;
+#ifdef __SSE2__
+			for (; end - out >= 8; rgb += 3*8, out += 8)
+				sse2_ECMA48_from_rgb(rgb, out);
+#endif
+			for (; out != end; rgb += 3, ++out)
+				*out = ECMA48_from_rgb(rgb[0], rgb[1], rgb[2]);
+		}
 	}
 }
 
 // –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
-//                                Manipulators                                //
+//                                Color policy                                //
 // –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
 
 namespace dye {
-	// ··································
-	// Utility functions for manipulators
+	// Whether a stream receives control sequences is decided per stream and
+	// stored in one of its std::ios_base::iword slots. Streams default to
+	// AUTO_COLOR, which colors std::cout and std::cerr when they are attached to
+	// a terminal; isatty() is queried once per process, never per insertion.
+
+	enum ColorPolicy {
+		AUTO_COLOR   = 0, // Color stdout/stderr terminals only (default)
+		ALWAYS_COLOR = 1, // Always emit control sequences, e.g. to files or pipes
+		NEVER_COLOR  = 2  // Never emit control sequences
+	};
 
-	namespace {
-		inline bool is_stdout_stderr_tty(const std::ostream& s) {
-			return (s.rdbuf()==std::cout.rdbuf() && isatty(fileno(stdout)))
-			    || (s.rdbuf()==std::cerr.rdbuf() && isatty(fileno(stderr)));
-		}
+	// Index of the iword slot holding a stream's ColorPolicy. Not in an anonymous
+	// namespace: all translation units must share the same slot.
+	inline int color_policy_index() {
+		static const int index = std::ios_base::xalloc();
+		return index;
 	}
 
-	// ––––––––––––––––––––––––
-	// Public manipulator tools
+	// ––––––––––––––––
+	// Public interface
 
-	class CachedManipulator {
-		mutable std::string _cached_control_sequence;
-		mutable bool        _cached;
-		public:
-			CachedManipulator() : _cached(false) {}
-			CachedManipulator(const std::string& control_sequence)
-				: _cached_control_sequence(control_sequence)
-				, _cached(true) {}
-			virtual ~CachedManipulator() {}
-
-			std::ostream& manipulate(std::ostream& stream) const {
-				if (!_cached) setCache(eval());
-				stream << _cached_control_sequence;
-				return stream;
-			}
-		protected:
-			virtual std::string eval() const {
-				return _cached_control_sequence;
-			}
-			void invalidate() const { _cached = false; }
-			void setCache(const std::string& new_cached_control_sequence) const {
-				_cached_control_sequence = new_cached_control_sequence;
-				_cached = true;
-			}
-	};
+	// isatty() results, queried once per process
+	inline bool stdout_is_tty() {
+		static const bool is_tty = isatty(fileno(stdout));
+		return is_tty;
+	}
 
-	typedef CachedManipulator Manipulator;
+	inline bool stderr_is_tty() {
+		static const bool is_tty = isatty(fileno(stderr));
+		return is_tty;
+	}
 
-	inline std::ostream& operator<<(std::ostream& stream, const Manipulator& m) {
-		if (is_stdout_stderr_tty(stream)) return m.manipulate(stream);
+	inline void set_color_policy(std::ios_base& stream, ColorPolicy policy) {
+		stream.iword(color_policy_index()) = policy;
+	}
+
+	inline ColorPolicy color_policy(std::ios_base& stream) {
+		return static_cast<ColorPolicy>(stream.iword(color_policy_index()));
+	}
+
+	inline bool is_colored(std::ostream& stream) {
+		switch (stream.iword(color_policy_index())) {
+			case ALWAYS_COLOR: return true;
+			case NEVER_COLOR:  return false;
+			default:
+				return (stream.rdbuf()==std::cout.rdbuf() && stdout_is_tty())
+				    || (stream.rdbuf()==std::cerr.rdbuf() && stderr_is_tty());
+		}
+	}
+
+	// Stream manipulators, e.g. file << dye::always_color << dye::red << "Red";
+
+	inline std::ostream& auto_color(std::ostream& stream) {
+		set_color_policy(stream, AUTO_COLOR);
 		return stream;
 	}
 
-	// Manipulator generators
+	inline std::ostream& always_color(std::ostream& stream) {
+		set_color_policy(stream, ALWAYS_COLOR);
+		return stream;
+	}
 
-	class ColorManipulatorGenerator {
-		public:
-			virtual ~ColorManipulatorGenerator() {};
-			virtual std::string fg() const = 0;
-			virtual std::string bg() const = 0;
-			virtual ColorManipulatorGenerator* clone() const = 0;
-	};
+	inline std::ostream& never_color(std::ostream& stream) {
+		set_color_policy(stream, NEVER_COLOR);
+		return stream;
+	}
+}
 
-	class PrecomputedColorGenerator : public ColorManipulatorGenerator {
-		const std::string _fg;
-		const std::string _bg;
-		public:
-			PrecomputedColorGenerator(const std::string& fg, const std::string& bg) : _fg(fg), _bg(bg) {}
-			virtual std::string fg() const { return _fg; }
-			virtual std::string bg() const { return _bg; }
-			virtual ColorManipulatorGenerator* clone() const {
-				return new PrecomputedColorGenerator(_fg, _bg);
-			}
-	};
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                              Repetition policy                             //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
 
-	class Xterm256Generator : public ColorManipulatorGenerator {
-		size_t _i;
-		public:
-			Xterm256Generator(size_t i) : _i(i) {}
-			virtual std::string fg() const { return ECMA48::foreground_256(_i); }
-			virtual std::string bg() const { return ECMA48::background_256(_i); }
-			virtual ColorManipulatorGenerator* clone() const {
-				return new Xterm256Generator(_i);
-			}
+namespace dye {
+	// Runs of an identical graphic character can be written as the character
+	// followed by REP (§8.3.103), e.g. 80 dashes as "-" ESC[79b. StyledStream and
+	// Screen do so on streams whose policy allows it, stored like the color policy
+	// in an iword slot. Streams default to NEVER_REPEAT: REP is only understood by
+	// some terminals, and only makes sense on colored streams.
+
+	enum RepeatPolicy {
+		NEVER_REPEAT  = 0, // Write every character (default)
+		AUTO_REPEAT   = 1, // Use REP if the terminal is known to support it
+		ALWAYS_REPEAT = 2  // Use REP
 	};
 
-	class Xterm24bitGenerator : public ColorManipulatorGenerator {
-		size_t _r, _g, _b;
-		public:
-			Xterm24bitGenerator(size_t r, size_t g, size_t b) : _r(r), _g(g), _b(b) {}
-			Xterm24bitGenerator(const RGB& c) : _r(c.r), _g(c.g), _b(c.b) {}
-			virtual std::string fg() const { return ECMA48::foreground_24bit(_r,_g,_b); }
-			virtual std::string bg() const { return ECMA48::background_24bit(_r,_g,_b); }
-			virtual ColorManipulatorGenerator* clone() const {
-				return new Xterm24bitGenerator(_r, _g, _b);
-			}
-	};
+	// Index of the iword slot holding a stream's RepeatPolicy, shared by all
+	// translation units
+	inline int repeat_policy_index() {
+		static const int index = std::ios_base::xalloc();
+		return index;
+	}
 
-	// Color manipulators expressions
+	// ––––––––––––––––
+	// Public interface
 
-	// Forward declarations
-	template <typename CM, typename ObjectType> class ScopedColorManipulator;
-	template <typename CM> class NegatedColorManipulator;
+	// xterm implements REP, as do terminals identifying as xterm, except VTE and
+	// Konsole based ones, which did not for a long time
+	inline bool terminal_is_rep_capable() {
+		char const* TERM = std::getenv("TERM");
+		return TERM != 0 && std::strncmp(TERM, "xterm", 5) == 0
+		    && std::getenv("VTE_VERSION") == 0
+		    && std::getenv("KONSOLE_VERSION") == 0;
+	}
 
-	template <typename CM>
-	struct ColorManipulatorExpression {
-		std::ostream& manipulate(std::ostream& s, bool inverted = false) const {
-			return static_cast<const CM&>(*this).manipulate(s, inverted);
-		}
+	// terminal_is_rep_capable(), evaluated once per process on first use
+	inline bool is_rep_capable() {
+		static const bool capable = terminal_is_rep_capable();
+		return capable;
+	}
 
-		std::string fg() const { std::stringstream ss; manipulate(ss);       return ss.str(); }
-		std::string bg() const { std::stringstream ss; manipulate(ss, true); return ss.str(); }
+	inline void set_repeat_policy(std::ios_base& stream, RepeatPolicy policy) {
+		stream.iword(repeat_policy_index()) = policy;
+	}
 
-		operator CM&()             { return static_cast<      CM&>(*this); }
-		operator CM const&() const { return static_cast<const CM&>(*this); }
+	inline RepeatPolicy repeat_policy(std::ios_base& stream) {
+		return static_cast<RepeatPolicy>(stream.iword(repeat_policy_index()));
+	}
 
-		template <typename ObjectType>
-		ScopedColorManipulator<CM,ObjectType> operator()(const ObjectType& object) const {
-			return ScopedColorManipulator<CM,ObjectType>(*this, object);
+	// Whether runs of characters are written with REP to stream
+	inline bool is_repeated(std::ostream& stream) {
+		switch (stream.iword(repeat_policy_index())) {
+			case ALWAYS_REPEAT: return is_colored(stream);
+			case AUTO_REPEAT:   return is_colored(stream) && is_rep_capable();
+			default:            return false;
 		}
+	}
 
-		NegatedColorManipulator<CM> operator~() const {
-			return NegatedColorManipulator<CM>(*this);
-		}
-	};
+	// Whether a character of `length` bytes followed by REP(n-1) is shorter than
+	// the character written n times
+	inline bool repetition_is_shorter(size_t length, size_t n) {
+		if (n < 2) return false;
+		const size_t rep_length = ECMA48::C1::LENGTH + 1
+		                        + (n == 2 ? 0 : ECMA48::ControlSequence::decimal_length(n - 1));
+		return length + rep_length < n * length;
+	}
+
+	// Stream manipulators, e.g. std::cout << dye::auto_repeat;
+
+	inline std::ostream& auto_repeat(std::ostream& stream) {
+		set_repeat_policy(stream, AUTO_REPEAT);
+		return stream;
+	}
+
+	inline std::ostream& always_repeat(std::ostream& stream) {
+		set_repeat_policy(stream, ALWAYS_REPEAT);
+		return stream;
+	}
+
+	inline std::ostream& never_repeat(std::ostream& stream) {
+		set_repeat_policy(stream, NEVER_REPEAT);
+		return stream;
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                Manipulators                                //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ––––––––––––––––––––––––
+	// Public manipulator tools
+
+	// Manipulator writing a fixed control sequence of at most
+	// ECMA48::ControlSequence::MAX_LENGTH bytes. Immutable, so that a shared
+	// manipulator can be streamed from any number of threads.
+	class Manipulator {
+		typedef ECMA48::SequenceBuffer<ECMA48::ControlSequence::MAX_LENGTH> Sequence;
+		Sequence _control_sequence;
+		public:
+			constexpr Manipulator(const ECMA48::SequenceView& control_sequence)
+				: _control_sequence(control_sequence) {}
+			Manipulator(const std::string& control_sequence)
+				: _control_sequence(control_sequence.data(), control_sequence.size()) {}
+
+			constexpr ECMA48::SequenceView control_sequence() const { return _control_sequence.view(); }
+
+			template <typename STREAM>
+			STREAM& manipulate(STREAM& stream) const {
+				stream.write(_control_sequence.data(), _control_sequence.size());
+				return stream;
+			}
+	};
+
+	// Former name of Manipulator, which used to lazily cache its control sequence
+	typedef Manipulator CachedManipulator;
+
+	inline std::ostream& operator<<(std::ostream& stream, const Manipulator& m) {
+		if (is_colored(stream)) return m.manipulate(stream);
+		return stream;
+	}
+
+	// Color manipulators expressions
+
+	// Forward declarations
+	template <typename CM, typename ObjectType> class ScopedColorManipulator;
+	template <typename CM> class NegatedColorManipulator;
+
+	// Expressions are written to any STREAM providing write(const char*, size)
+	// and operator<< for the objects of scoped manipulators, e.g. std::ostream
+	// or FdWriter.
+	template <typename CM>
+	struct ColorManipulatorExpression {
+		template <typename STREAM>
+		STREAM& manipulate(STREAM& s, bool inverted = false) const {
+			return static_cast<const CM&>(*this).manipulate(s, inverted);
+		}
+
+		// Output of the expression on streams that are not colored
+		template <typename STREAM>
+		STREAM& uncolored(STREAM& s) const { return s; }
+
+		std::string fg() const { std::stringstream ss; manipulate(ss);       return ss.str(); }
+		std::string bg() const { std::stringstream ss; manipulate(ss, true); return ss.str(); }
+
+		operator CM&()             { return static_cast<      CM&>(*this); }
+		operator CM const&() const { return static_cast<const CM&>(*this); }
+
+		template <typename ObjectType>
+		ScopedColorManipulator<CM,ObjectType> operator()(const ObjectType& object) const {
+			return ScopedColorManipulator<CM,ObjectType>(*this, object);
+		}
+
+		NegatedColorManipulator<CM> operator~() const {
+			return NegatedColorManipulator<CM>(*this);
+		}
+	};
 
 	template <typename CM>
 	inline std::ostream& operator<<(std::ostream& stream, const ColorManipulatorExpression<CM>& cm) {
-		if (is_stdout_stderr_tty(stream)) return cm.manipulate(stream);
-		return stream;
+		if (is_colored(stream)) return cm.manipulate(stream);
+		return static_cast<const CM&>(cm).uncolored(stream);
 	}
 
 	template <typename CM>
@@ -1179,9 +2568,18 @@ namespace dye {
 		const CM& _cm;
 		public:
 			NegatedColorManipulator(const ColorManipulatorExpression<CM>& cm) : _cm(cm) {}
-			std::ostream& manipulate(std::ostream& stream, bool inverted = false) const {
+			const CM& manipulator() const { return _cm; }
+			bool is_background(bool inverted = false) const {
+				return _cm.is_background(!inverted);
+			}
+			template <typename STREAM>
+			STREAM& manipulate(STREAM& stream, bool inverted = false) const {
 				return _cm.manipulate(stream, !inverted);
 			}
+			template <typename STREAM>
+			STREAM& uncolored(STREAM& stream) const {
+				return _cm.uncolored(stream);
+			}
 	};
 
 	template <typename CM, typename ObjectType>
@@ -1193,83 +2591,148 @@ namespace dye {
 			ScopedColorManipulator(const CM& cm, const ObjectType& object)
 				: _cm(cm), _object(object) {}
 
-			std::ostream& manipulate(std::ostream& stream, bool inverted = false) const {
-				if (!is_stdout_stderr_tty(stream)) {
-					stream << _object;
-					return stream;
-				} else {
-					_cm.manipulate(stream, inverted);
-					stream << _object;
-					return reset(stream);
-				}
+			const CM& manipulator() const { return _cm; }
+			const ObjectType& object() const { return _object; }
+			bool is_background(bool inverted = false) const {
+				return _cm.is_background(inverted);
+			}
+
+			template <typename STREAM>
+			STREAM& manipulate(STREAM& stream, bool inverted = false) const {
+				_cm.manipulate(stream, inverted);
+				stream << _object;
+				return reset(stream, _cm.is_background(inverted));
+			}
+
+			template <typename STREAM>
+			STREAM& uncolored(STREAM& stream) const {
+				stream << _object;
+				return stream;
 			}
 
 		private:
-			static std::ostream& reset(std::ostream& stream) {
-				// TODO Reset attributes more thoroughly and efficiently
-				stream << ECMA48::default_color << ECMA48::default_background;
+			// Resets only the color that was changed
+			template <typename STREAM>
+			static STREAM& reset(STREAM& stream, bool background) {
+				const ECMA48::SequenceView& sequence = background ? ECMA48::default_background
+				                                                  : ECMA48::default_color;
+				stream.write(sequence.data(), sequence.size());
 				return stream;
 			}
 	};
 
 	// Color manipulators
 
-	class ColorManipulator : public CachedManipulator, public ColorManipulatorExpression<ColorManipulator> {
-		ColorManipulatorGenerator* _cmg;
+	// Longest color control sequence, CSI 38;2;255;255;255 m
+	const size_t MAX_COLOR_SEQUENCE_LENGTH = sizeof("\x1b[38;2;255;255;255m") - 1;
+
+	typedef ECMA48::SequenceBuffer<MAX_COLOR_SEQUENCE_LENGTH> ColorSequence;
+
+	// Color manipulator holding its foreground and background control sequences
+	// inline. It is a trivially copyable value: copies never allocate, and a
+	// shared ColorManipulator can be streamed from any number of threads.
+	class ColorManipulator : public ColorManipulatorExpression<ColorManipulator> {
+		ColorSequence _fg;
+		ColorSequence _bg;
 		bool _is_bg;
 		public:
-			ColorManipulator(ColorManipulatorGenerator* cmg) : _cmg(cmg), _is_bg(false) {}
-			ColorManipulator(const ColorManipulator& other)
-				: _cmg(other._cmg->clone()), _is_bg(other._is_bg) {}
+			constexpr ColorManipulator(const ColorSequence& fg, const ColorSequence& bg)
+				: _fg(fg), _bg(bg), _is_bg(false) {}
+			constexpr ColorManipulator(const ECMA48::SequenceView& fg, const ECMA48::SequenceView& bg)
+				: _fg(fg), _bg(bg), _is_bg(false) {}
+			// Background expressions, e.g. ~dye::red, make background manipulators
 			template <typename CM>
 			ColorManipulator(const ColorManipulatorExpression<CM>& cm)
-				: _cmg(new PrecomputedColorGenerator(cm.fg(), cm.bg()))
-				, _is_bg(false) {}
-			virtual ~ColorManipulator() { delete _cmg; };
+				: _fg(sequence(is_background(cm) ? cm.bg() : cm.fg()))
+				, _bg(sequence(is_background(cm) ? cm.fg() : cm.bg()))
+				, _is_bg(is_background(cm)) {}
 
 			// Convenience static constructors
 			static ColorManipulator precomputedColor(const std::string& fg, const std::string& bg) {
-				return ColorManipulator(new PrecomputedColorGenerator(fg, bg));
+				return ColorManipulator(sequence(fg), sequence(bg));
 			}
-			static ColorManipulator xterm256(size_t i) { return ColorManipulator(new Xterm256Generator(i)); }
+			// Copy of a precomputed table entry
+			static ColorManipulator xterm256(size_t i);
 			static ColorManipulator xterm24bit(size_t r, size_t g, size_t b) {
-				return ColorManipulator(new Xterm24bitGenerator(r,g,b));
+				char fg[ECMA48::ControlSequence::MAX_LENGTH];
+				char bg[ECMA48::ControlSequence::MAX_LENGTH];
+				return ColorManipulator(ColorSequence(fg, ECMA48::encode_foreground_24bit(fg, r,g,b) - fg),
+				                        ColorSequence(bg, ECMA48::encode_background_24bit(bg, r,g,b) - bg));
 			}
 			static ColorManipulator xterm24bit(const RGB& c) {
 				return xterm24bit(c.r, c.g, c.b);
 			}
 
-			bool is_bg() const { return _is_bg; }
-			void invert() { _is_bg = !_is_bg; CachedManipulator::invalidate(); }
+			constexpr const ColorSequence& fg() const { return _fg; }
+			constexpr const ColorSequence& bg() const { return _bg; }
 
-			std::ostream& manipulate(std::ostream& stream, bool inverted = false) const {
-				if (is_stdout_stderr_tty(stream)) {
-					if (_is_bg != inverted) CachedManipulator::setCache(_cmg->bg());
-					else CachedManipulator::setCache(_cmg->fg());
+			bool is_bg() const { return _is_bg; }
+			bool is_background(bool inverted = false) const { return _is_bg != inverted; }
+			void invert() { _is_bg = !_is_bg; }
 
-					return CachedManipulator::manipulate(stream);
-				}
+			template <typename STREAM>
+			STREAM& manipulate(STREAM& stream, bool inverted = false) const {
+				const ColorSequence& control_sequence = _is_bg != inverted ? _bg : _fg;
+				stream.write(control_sequence.data(), control_sequence.size());
 				return stream;
 			}
+
+		private:
+			static ColorSequence sequence(const std::string& s) {
+				return ColorSequence(s.data(), s.size());
+			}
+
+			template <typename CM>
+			static bool is_background(const ColorManipulatorExpression<CM>& cm) {
+				return static_cast<const CM&>(cm).is_background();
+			}
 	};
 
 	inline std::ostream& operator<<(std::ostream& stream, const ColorManipulator& cm) {
-		if (is_stdout_stderr_tty(stream)) return cm.manipulate(stream);
+		if (is_colored(stream)) return cm.manipulate(stream);
 		return stream;
 	}
 
+	// ·····················································
+	// Precomputed manipulators for the 256 xterm256 indices
+
+	// Named rather than anonymous so that the table is shared between all
+	// translation units.
+	namespace detail {
+		template <typename INDICES>
+		struct Xterm256Table;
+
+		template <size_t... I>
+		struct Xterm256Table< ECMA48::detail::Indices<I...> > {
+			static constexpr ColorManipulator entries[sizeof...(I)] = {
+				ColorManipulator(ColorSequence(ECMA48::detail::IndexedColor(38, I)),
+				                 ColorSequence(ECMA48::detail::IndexedColor(48, I)))...
+			};
+		};
+
+		template <size_t... I>
+		constexpr ColorManipulator Xterm256Table< ECMA48::detail::Indices<I...> >::entries[sizeof...(I)];
+
+		typedef Xterm256Table< ECMA48::detail::MakeIndices<256>::type > xterm256_table;
+	}
+
+	inline ColorManipulator ColorManipulator::xterm256(size_t i) {
+		assert(i <= 255);
+		return detail::xterm256_table::entries[i];
+	}
+
 	// ––––––––––––––––––––
 	// 8-color manipulators
 
-	const ColorManipulator   black = ColorManipulator::precomputedColor(ECMA48::black,   ECMA48::black_background);
-	const ColorManipulator     red = ColorManipulator::precomputedColor(ECMA48::red,     ECMA48::red_background);
-	const ColorManipulator   green = ColorManipulator::precomputedColor(ECMA48::green,   ECMA48::green_background);
-	const ColorManipulator  yellow = ColorManipulator::precomputedColor(ECMA48::yellow,  ECMA48::yellow_background);
-	const ColorManipulator    blue = ColorManipulator::precomputedColor(ECMA48::blue,    ECMA48::blue_background);
-	const ColorManipulator magenta = ColorManipulator::precomputedColor(ECMA48::magenta, ECMA48::magenta_background);
-	const ColorManipulator    cyan = ColorManipulator::precomputedColor(ECMA48::cyan,    ECMA48::cyan_background);
-	const ColorManipulator   white = ColorManipulator::precomputedColor(ECMA48::white,   ECMA48::white_background);
-	const Manipulator reset(ECMA48::default_color);
+	constexpr ColorManipulator   black(ECMA48::black,   ECMA48::black_background);
+	constexpr ColorManipulator     red(ECMA48::red,     ECMA48::red_background);
+	constexpr ColorManipulator   green(ECMA48::green,   ECMA48::green_background);
+	constexpr ColorManipulator  yellow(ECMA48::yellow,  ECMA48::yellow_background);
+	constexpr ColorManipulator    blue(ECMA48::blue,    ECMA48::blue_background);
+	constexpr ColorManipulator magenta(ECMA48::magenta, ECMA48::magenta_background);
+	constexpr ColorManipulator    cyan(ECMA48::cyan,    ECMA48::cyan_background);
+	constexpr ColorManipulator   white(ECMA48::white,   ECMA48::white_background);
+	constexpr Manipulator reset(ECMA48::default_color);
 
 	// –––––––––––––––––––––––––
 	// xterm256 RGB manipulators
@@ -1327,7 +2790,67 @@ namespace dye {
 	    return VTE_24;
 	}
 
-	const bool _is_24bit_capable = terminal_is_24bit_capable();
+	// terminal_is_24bit_capable(), evaluated once per process on first use
+	inline bool is_24bit_capable() {
+		static const bool capable = terminal_is_24bit_capable();
+		return capable;
+	}
+
+	// Color depth of manipulators holding both encodings, like colormap LUT
+	// entries, chosen per stream and stored like the color policy in an iword
+	// slot
+	enum ColorDepth {
+		AUTO_DEPTH      = 0, // 24-bit colors if the terminal supports them (default)
+		XTERM256_DEPTH  = 1, // xterm256 colors
+		TRUECOLOR_DEPTH = 2  // 24-bit colors
+	};
+
+	// Index of the iword slot holding a stream's ColorDepth, shared by all
+	// translation units
+	inline int color_depth_index() {
+		static const int index = std::ios_base::xalloc();
+		return index;
+	}
+
+	inline void set_color_depth(std::ios_base& stream, ColorDepth depth) {
+		stream.iword(color_depth_index()) = depth;
+	}
+
+	inline ColorDepth color_depth(std::ios_base& stream) {
+		return static_cast<ColorDepth>(stream.iword(color_depth_index()));
+	}
+
+	inline bool is_24bit(std::ios_base& stream) {
+		switch (stream.iword(color_depth_index())) {
+			case TRUECOLOR_DEPTH: return true;
+			case XTERM256_DEPTH:  return false;
+			default:              return is_24bit_capable();
+		}
+	}
+
+	namespace detail {
+		// Depth of any stream written by expressions: streams without iword
+		// slots, like FdWriter, follow the terminal
+		inline bool stream_is_24bit(std::ios_base* stream) { return is_24bit(*stream); }
+		inline bool stream_is_24bit(const void*) { return is_24bit_capable(); }
+	}
+
+	// Stream manipulators, e.g. std::cout << dye::xterm256_depth;
+
+	inline std::ostream& auto_depth(std::ostream& stream) {
+		set_color_depth(stream, AUTO_DEPTH);
+		return stream;
+	}
+
+	inline std::ostream& xterm256_depth(std::ostream& stream) {
+		set_color_depth(stream, XTERM256_DEPTH);
+		return stream;
+	}
+
+	inline std::ostream& truecolor_depth(std::ostream& stream) {
+		set_color_depth(stream, TRUECOLOR_DEPTH);
+		return stream;
+	}
 
 	// RGB manipulators auto-selecting 256 color or 24-bit color base on capabilities
 
@@ -1335,7 +2858,7 @@ namespace dye {
 		assert(r <= 255);
 		assert(g <= 255);
 		assert(b <= 255);
-		if (_is_24bit_capable)
+		if (is_24bit_capable())
 			return rgb24bit(r,g,b);
 		else
 			return rgb256(r,g,b);
@@ -1344,170 +2867,3292 @@ namespace dye {
 	inline ColorManipulator rgb(const RGB& c) { return rgb(c.r, c.g, c.b); }
 
 	inline ColorManipulator hsv(float H, float S, float V) { return rgb(RGB::fromHSV(H,S,V)); }
-}
-
-// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
-//                                 Color maps                                 //
-// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
 
-namespace dye {
-	// ·································
-	// Utilities functions for colormaps
+	// –––––––––––––––––––––––––––––––––
+	// Manipulators of both color depths
 
-	namespace {
-		inline float upramp(float x, float center, float width) {
-		    return 255.0f * (1.0f + std::tanh(6.0f / width * (x - center))) / 2.0f;
-		}
+	// Entry of a colormap LUT: a view of its 64-byte slot, holding the
+	// foreground and background sequences in 24-bit and xterm256 colors. The
+	// encoding is chosen per stream, see ColorDepth. Entries are expressions:
+	// they can be negated, scoped, or converted to ColorManipulators, and are
+	// valid as long as their LUT.
+	class ColormapEntry : public ColorManipulatorExpression<ColormapEntry> {
+		public:
+			// Slot layout: sequences at fixed offsets, then their lengths
+			static const size_t SLOT_SIZE        = 64;
+			static const size_t FG_24BIT         = 0;
+			static const size_t BG_24BIT         = FG_24BIT + MAX_COLOR_SEQUENCE_LENGTH;
+			static const size_t FG_XTERM256      = BG_24BIT + MAX_COLOR_SEQUENCE_LENGTH;
+			static const size_t BG_XTERM256      = FG_XTERM256 + sizeof("\x1b[38;5;255m") - 1;
+			static const size_t LENGTHS          = BG_XTERM256 + sizeof("\x1b[48;5;255m") - 1;
+
+			ColormapEntry(const char* slot, bool is_bg = false)
+				: slot_(slot)
+				, is_bg_(is_bg)
+				{}
 
-		inline float downramp(float x, float center, float width) {
-		    return 255.0f * (1.0f - std::tanh(6.0f / width * (x - center))) / 2.0f;
-		}
-	}
+			bool is_background(bool inverted = false) const { return is_bg_ != inverted; }
 
-	// ·············
-	// Colormap data
+			ECMA48::SequenceView sequence(bool truecolor, bool background) const {
+				const size_t field = truecolor ? (background ? 1 : 0) : (background ? 3 : 2);
+				static const size_t offsets[4] = { FG_24BIT, BG_24BIT, FG_XTERM256, BG_XTERM256 };
+				return ECMA48::SequenceView(slot_ + offsets[field], uint8_t(slot_[LENGTHS + field]));
+			}
 
-	namespace {
-		inline RGB hot_function(float x) {
-			return RGB(upramp(x, 1/6.0, 1/3.0),
-			           upramp(x, 1/2.0, 1/3.0),
-			           upramp(x, 5/6.0, 1/3.0));
-		}
+			ColorManipulator manipulator(bool truecolor) const {
+				ColorManipulator cm(sequence(truecolor, false), sequence(truecolor, true));
+				if (is_bg_) cm.invert();
+				return cm;
+			}
 
-	    inline RGB jet_function(float x) {
-	        if (x <= 0.5)
-	            return RGB(upramp(x, 5/8.0, 1/4.0),
-	                       upramp(x, 1/8.0, 1/4.0),
-	                     downramp(x, 3/8.0, 1/4.0));
-	        else
-	            return RGB(upramp(x, 5/8.0, 1/4.0),
-	                     downramp(x, 7/8.0, 1/4.0),
-	                     downramp(x, 3/8.0, 1/4.0));
-	    }
+			template <typename STREAM>
+			STREAM& manipulate(STREAM& stream, bool inverted = false) const {
+				const ECMA48::SequenceView s = sequence(detail::stream_is_24bit(&stream), is_bg_ != inverted);
+				stream.write(s.data(), s.size());
+				return stream;
+			}
 
-	    inline RGB hsv_function(float x) {
-	        if (x<=1/3.0)
-	            return RGB(downramp(x, 3/12.0, 1/6.0),
-	                         upramp(x, 1/12.0, 1/6.0),
-	                       0.0);
-	        else if (x<=2/3.0)
-	            return RGB(0.0,
-	                       downramp(x, 7/12.0, 1/6.0),
-	                         upramp(x, 5/12.0, 1/6.0));
-	        else
-	            return RGB(upramp(x, 9/12.0, 1/6.0),
-	                       0.0,
-	                       downramp(x, 11/12.0, 1/6.0));
-	    }
+		private:
+			const char* slot_;
+			bool is_bg_;
+	};
 
-	    inline RGB good_function(float x) {
-	        return RGB(downramp(x, 8/12.0, 2/3.0),
-	                     upramp(x, 4/12.0, 2/3.0),
-	                   0.0);
-	    }
+	// Color interpolated between two entries of a colormap LUT, encoded when it
+	// is written
+	class ColormapBlend : public ColorManipulatorExpression<ColormapBlend> {
+		public:
+			ColormapBlend(uint8_t r, uint8_t g, uint8_t b, bool is_bg = false)
+				: is_bg_(is_bg)
+				{
+					rgb_[0] = r;
+					rgb_[1] = g;
+					rgb_[2] = b;
+				}
 
-	    inline RGB gray_function(float x) {
-	        return RGB(x,x,x) * 255.0f;
-	    }
-	}
+			bool is_background(bool inverted = false) const { return is_bg_ != inverted; }
 
-	// –––––––––––––––––––––
-	// Colormap public tools
+			ColorManipulator manipulator(bool truecolor) const {
+				ColorManipulator cm = truecolor ? rgb24bit(rgb_[0], rgb_[1], rgb_[2])
+				                                : rgb256(rgb_[0], rgb_[1], rgb_[2]);
+				if (is_bg_) cm.invert();
+				return cm;
+			}
 
-	typedef RGB (*ColormapFunction)(float);
+			template <typename STREAM>
+			STREAM& manipulate(STREAM& stream, bool inverted = false) const {
+				const bool background = is_bg_ != inverted;
+				if (!detail::stream_is_24bit(&stream)) {
+					const ColorManipulator& cm = detail::xterm256_table::entries[
+						xterm256::ECMA48_from_rgb(rgb_[0], rgb_[1], rgb_[2])];
+					const ColorSequence& sequence = background ? cm.bg() : cm.fg();
+					stream.write(sequence.data(), sequence.size());
+					return stream;
+				}
+				char buffer[MAX_COLOR_SEQUENCE_LENGTH];
+				const char* end = background ? ECMA48::encode_background_24bit(buffer, rgb_[0], rgb_[1], rgb_[2])
+				                             : ECMA48::encode_foreground_24bit(buffer, rgb_[0], rgb_[1], rgb_[2]);
+				stream.write(buffer, end - buffer);
+				return stream;
+			}
 
-	class Colormap {
 		private:
-			inline float normalize(float x) const {
-				if (x < 0.0f) x = 0.0f;
-				if (x > 1.0f) x = 1.0f;
-				return x;
-			}
+			uint8_t rgb_[3];
+			bool is_bg_;
+	};
+}
 
-		public:
-			Colormap(ColormapFunction f) : f_(f) {}
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                             Graphic renditions                             //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
 
-			// operator()
+namespace dye {
+	// A graphic rendition is the state selected by SGR (§8.3.117): foreground
+	// and background colors plus a set of attributes. Tracking it lets dye write
+	// only the parameters needed to go from one rendition to another.
 
-			ColorManipulator operator()(float x) const {
-				return dye::rgb(f_(normalize(x)));
-			}
+	// ·····
+	// Color
 
-			ColorManipulator operator()(size_t percentage) const {
-				return operator()(percentage / 100.0f);
-			}
+	class Color {
+		public:
+			enum Kind {
+				DEFAULT,  // SGR 39 / 49
+				STANDARD, // SGR 30-37 / 40-47, and 90-97 / 100-107 for indices 8-15
+				XTERM256, // SGR 38;5;i / 48;5;i
+				RGB24     // SGR 38;2;r;g;b / 48;2;r;g;b
+			};
 
-			ColorManipulator operator()(int percentage) const {
-				return operator()(percentage / 100.0f);
+			constexpr Color()
+				: kind_(DEFAULT), r_(0), g_(0), b_(0)
+				{}
+
+			static constexpr Color standard(size_t i) { return Color(STANDARD, i, 0, 0); }
+			static constexpr Color xterm256(size_t i) { return Color(XTERM256, i, 0, 0); }
+			static constexpr Color rgb24(size_t r, size_t g, size_t b) { return Color(RGB24, r, g, b); }
+
+			// Accessors
+
+			constexpr Kind kind() const { return Kind(kind_); }
+			constexpr size_t index() const { return r_; }
+			constexpr size_t r() const { return r_; }
+			constexpr size_t g() const { return g_; }
+			constexpr size_t b() const { return b_; }
+
+			constexpr bool is_default() const { return kind_ == DEFAULT; }
+
+			// Writes the SGR parameters selecting this color as foreground or
+			// background to ps, and returns their number (at most MAX_PARAMETERS)
+			size_t parameters(size_t* ps, bool background) const {
+				const size_t offset = background ? 10 : 0;
+				switch (kind()) {
+					case DEFAULT:
+						ps[0] = 39 + offset;
+						return 1;
+					case STANDARD:
+						ps[0] = (r_ < 8 ? 30 + r_ : 90 + r_ - 8) + offset;
+						return 1;
+					case XTERM256:
+						ps[0] = 38 + offset; ps[1] = 5; ps[2] = r_;
+						return 3;
+					default:
+						ps[0] = 38 + offset; ps[1] = 2; ps[2] = r_; ps[3] = g_; ps[4] = b_;
+						return 5;
+				}
 			}
 
+			static const size_t MAX_PARAMETERS = 5;
+
 		private:
-			ColormapFunction f_;
+			constexpr Color(Kind kind, size_t r, size_t g, size_t b)
+				: kind_(kind), r_(r), g_(g), b_(b)
+				{}
+
+			unsigned char kind_;
+			unsigned char r_, g_, b_;
 	};
 
-	template <size_t SIZE>
-	class ColormapLUT {
-		private:
-			inline size_t index(float x) const {
-				if (x < 0.0f) return 0;
-				if (x > 1.0f) return SIZE-1;
-				return x*(SIZE-1);
-			}
+	inline bool operator==(const Color& a, const Color& b) {
+		return a.kind() == b.kind() && a.r() == b.r() && a.g() == b.g() && a.b() == b.b();
+	}
 
-			void computeLUT_(const Colormap& c) {
-				fg_lut_.clear();
-				bg_lut_.clear();
-				fg_lut_.reserve(SIZE);
-				bg_lut_.reserve(SIZE);
+	inline bool operator!=(const Color& a, const Color& b) { return !(a == b); }
+
+	// ·········
+	// Rendition
+
+	struct Rendition {
+		// Attributes, named after the SGR shortcuts of dye::ECMA48
+		enum Attribute {
+			BOLD              = 1 << 0,  // SGR 1,  off with 22
+			FAINT             = 1 << 1,  // SGR 2,  off with 22
+			ITALIC            = 1 << 2,  // SGR 3,  off with 23
+			UNDERLINED        = 1 << 3,  // SGR 4,  off with 24
+			SLOW_BLINKING     = 1 << 4,  // SGR 5,  off with 25
+			RAPID_BLINKING    = 1 << 5,  // SGR 6,  off with 25
+			NEGATIVE          = 1 << 6,  // SGR 7,  off with 27
+			CONCEALED         = 1 << 7,  // SGR 8,  off with 28
+			CROSSED           = 1 << 8,  // SGR 9,  off with 29
+			FRAKTUR           = 1 << 9,  // SGR 20, off with 23
+			DOUBLY_UNDERLINED = 1 << 10, // SGR 21, off with 24
+			FRAMED            = 1 << 11, // SGR 51, off with 54
+			ENCIRCLED         = 1 << 12, // SGR 52, off with 54
+			OVERLINED         = 1 << 13  // SGR 53, off with 55
+		};
+
+		// Most parameters sgr_transition() can write
+		static const size_t MAX_TRANSITION_PARAMETERS = 9 + 14 + 2 * Color::MAX_PARAMETERS;
+
+		Color fg;
+		Color bg;
+		unsigned attributes;
+
+		constexpr Rendition()
+			: fg(), bg(), attributes(0)
+			{}
+
+		constexpr bool is_default() const {
+			return fg.is_default() && bg.is_default() && attributes == 0;
+		}
 
-				for (size_t i=0; i<SIZE; ++i) {
-					fg_lut_.push_back(c(i / float(SIZE-1)));
-					bg_lut_.push_back(~c(i / float(SIZE-1)));
-				}
-			}
+		bool has(Attribute attribute) const { return (attributes & attribute) != 0; }
 
-		public:
-			ColormapLUT(ColormapFunction f) {
-				computeLUT_(Colormap(f));
-			}
+		// Applies SGR parameters, in order. Returns false if some parameters were
+		// not understood (e.g. fonts); they are skipped.
+		bool apply(const size_t* ps, size_t count);
 
-			ColormapLUT(const Colormap& c) {
-				computeLUT_(c);
-			}
+		// Applies the parameters of a control sequence token if it is SGR, with
+		// 38:2:<color space>:r:g:b (ITU T.416) sub-parameters; ignores others
+		bool apply(const ECMA48::Token& token);
+	};
 
-			// operator()
+	inline bool operator==(const Rendition& a, const Rendition& b) {
+		return a.fg == b.fg && a.bg == b.bg && a.attributes == b.attributes;
+	}
 
-			ColorManipulator operator()(float x) const {
-				return fg_lut_[index(x)];
-			}
+	inline bool operator!=(const Rendition& a, const Rendition& b) { return !(a == b); }
 
-			ColorManipulator operator()(size_t percentage) const {
-				return operator()(percentage / 100.0f);
+	namespace {
+		struct AttributeCode {
+			unsigned attributes;
+			size_t parameter;
+		};
+
+		const AttributeCode _ATTRIBUTES_ON[] = {
+			{Rendition::BOLD,               1},
+			{Rendition::FAINT,              2},
+			{Rendition::ITALIC,             3},
+			{Rendition::UNDERLINED,         4},
+			{Rendition::SLOW_BLINKING,      5},
+			{Rendition::RAPID_BLINKING,     6},
+			{Rendition::NEGATIVE,           7},
+			{Rendition::CONCEALED,          8},
+			{Rendition::CROSSED,            9},
+			{Rendition::FRAKTUR,           20},
+			{Rendition::DOUBLY_UNDERLINED, 21},
+			{Rendition::FRAMED,            51},
+			{Rendition::ENCIRCLED,         52},
+			{Rendition::OVERLINED,         53}
+		};
+
+		// Each parameter turns off a group of attributes
+		const AttributeCode _ATTRIBUTES_OFF[] = {
+			{Rendition::BOLD          | Rendition::FAINT,             22},
+			{Rendition::ITALIC        | Rendition::FRAKTUR,           23},
+			{Rendition::UNDERLINED    | Rendition::DOUBLY_UNDERLINED, 24},
+			{Rendition::SLOW_BLINKING | Rendition::RAPID_BLINKING,    25},
+			{Rendition::NEGATIVE,                                     27},
+			{Rendition::CONCEALED,                                    28},
+			{Rendition::CROSSED,                                      29},
+			{Rendition::FRAMED        | Rendition::ENCIRCLED,         54},
+			{Rendition::OVERLINED,                                    55}
+		};
+
+		const size_t _ATTRIBUTES_ON_COUNT  = sizeof(_ATTRIBUTES_ON)  / sizeof(_ATTRIBUTES_ON[0]);
+		const size_t _ATTRIBUTES_OFF_COUNT = sizeof(_ATTRIBUTES_OFF) / sizeof(_ATTRIBUTES_OFF[0]);
+
+		// Effect of the SGR parameter at ps[0], together with the arguments
+		// following it for 38 and 48
+		struct SGREffect {
+			enum Kind { UNKNOWN, RESET, FOREGROUND, BACKGROUND, ATTRIBUTES_ON, ATTRIBUTES_OFF };
+
+			Kind kind;
+			Color color;
+			unsigned attributes;
+			size_t consumed;
+
+			SGREffect(Kind kind, size_t consumed = 1)
+				: kind(kind), color(), attributes(0), consumed(consumed)
+				{}
+			SGREffect(Kind kind, const Color& color, size_t consumed = 1)
+				: kind(kind), color(color), attributes(0), consumed(consumed)
+				{}
+			SGREffect(Kind kind, unsigned attributes)
+				: kind(kind), color(), attributes(attributes), consumed(1)
+				{}
+		};
+
+		inline SGREffect sgr_effect(const size_t* ps, size_t count) {
+			const size_t p = ps[0];
+			const SGREffect::Kind color_kind = p < 40 || (p >= 90 && p <= 97) ? SGREffect::FOREGROUND
+			                                                                  : SGREffect::BACKGROUND;
+
+			if (p == 0) return SGREffect(SGREffect::RESET);
+			if ((p >= 30 && p <= 37) || (p >= 40 && p <= 47)) return SGREffect(color_kind, Color::standard(p % 10));
+			if ((p >= 90 && p <= 97) || (p >= 100 && p <= 107)) return SGREffect(color_kind, Color::standard(p % 10 + 8));
+			if (p == 39 || p == 49) return SGREffect(color_kind, Color());
+			if (p == 38 || p == 48) {
+				if (count >= 3 && ps[1] == 5 && ps[2] <= 255)
+					return SGREffect(color_kind, Color::xterm256(ps[2]), 3);
+				if (count >= 5 && ps[1] == 2 && ps[2] <= 255 && ps[3] <= 255 && ps[4] <= 255)
+					return SGREffect(color_kind, Color::rgb24(ps[2], ps[3], ps[4]), 5);
+				return SGREffect(SGREffect::UNKNOWN);
 			}
+			for (size_t i=0; i<_ATTRIBUTES_ON_COUNT; ++i)
+				if (_ATTRIBUTES_ON[i].parameter == p)
+					return SGREffect(SGREffect::ATTRIBUTES_ON, _ATTRIBUTES_ON[i].attributes);
+			for (size_t i=0; i<_ATTRIBUTES_OFF_COUNT; ++i)
+				if (_ATTRIBUTES_OFF[i].parameter == p)
+					return SGREffect(SGREffect::ATTRIBUTES_OFF, _ATTRIBUTES_OFF[i].attributes);
+			return SGREffect(SGREffect::UNKNOWN);
+		}
 
-			ColorManipulator operator()(int percentage) const {
-				return operator()(percentage / 100.0f);
-			}
+		// Number of bytes of parameters once encoded, separators included
+		inline size_t parameters_length(const size_t* ps, size_t count) {
+			size_t length = 0;
+			for (size_t i=0; i<count; ++i)
+				length += ECMA48::ControlSequence::decimal_length(ps[i]) + 1;
+			return length;
+		}
 
-		private:
-			std::vector<ColorManipulator> fg_lut_;
-			std::vector<ColorManipulator> bg_lut_;
-	};
+		// Parameters selecting `to` from the initial rendition
+		inline size_t sgr_from_default(const Rendition& to, size_t* ps) {
+			size_t count = 0;
+			ps[count++] = 0;
+			for (size_t i=0; i<_ATTRIBUTES_ON_COUNT; ++i)
+				if (to.attributes & _ATTRIBUTES_ON[i].attributes)
+					ps[count++] = _ATTRIBUTES_ON[i].parameter;
+			if (!to.fg.is_default()) count += to.fg.parameters(ps + count, false);
+			if (!to.bg.is_default()) count += to.bg.parameters(ps + count, true);
+			return count;
+		}
+	}
 
-	// –––––––––
-	// Colormaps
+	inline bool Rendition::apply(const size_t* ps, size_t count) {
+		bool understood = true;
+		for (size_t i=0; i<count; ) {
+			const SGREffect effect = sgr_effect(ps + i, count - i);
+			switch (effect.kind) {
+				case SGREffect::RESET:          *this = Rendition();                 break;
+				case SGREffect::FOREGROUND:     fg = effect.color;                   break;
+				case SGREffect::BACKGROUND:     bg = effect.color;                   break;
+				case SGREffect::ATTRIBUTES_ON:  attributes |= effect.attributes;     break;
+				case SGREffect::ATTRIBUTES_OFF: attributes &= ~effect.attributes;    break;
+				case SGREffect::UNKNOWN:        understood = false;                  break;
+			}
+			i += effect.consumed;
+		}
+		return understood;
+	}
 
-	Colormap  hot(hot_function);
-	Colormap  jet(jet_function);
-	Colormap rainbow(hsv_function);
-	Colormap good(good_function);
-	Colormap gray(gray_function);
-
-	ColormapLUT<100>  hot100(hot);
-	ColormapLUT<100>  jet100(jet);
-	ColormapLUT<100> rainbow100(rainbow);
-	ColormapLUT<100> good100(good);
-	ColormapLUT<100> gray100(gray);
+	inline bool Rendition::apply(const ECMA48::Token& token) {
+		if (token.kind != ECMA48::Token::CONTROL_SEQUENCE || token.function != 'm'
+		    || token.private_marker != 0 || token.intermediates.size() != 0) return true;
+
+		size_t ps[ECMA48::Token::MAX_PARAMETERS];
+		size_t count = 0;
+		for (size_t i=0; i<token.parameter_count; ++i) {
+			const size_t p = token.parameters[i];
+			ps[count++] = p;
+			// Without the color space
+			if ((p == 38 || p == 48) && i + 5 < token.parameter_count
+			    && (token.subparameters >> (i + 1) & 0x1F) == 0x1F && token.parameters[i + 1] == 2) {
+				ps[count++] = 2;
+				i += 2;
+			}
+		}
+		if (count == 0) ps[count++] = 0;
+		return apply(ps, count);
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// Writes to ps the SGR parameters moving a terminal from rendition `from` to
+	// rendition `to`, and returns their number: 0 if both are equal. Either only
+	// the differences are written, or a reset (0) followed by all of `to`,
+	// whichever encodes shorter. ps must have room for MAX_TRANSITION_PARAMETERS.
+	inline size_t sgr_transition(const Rendition& from, const Rendition& to, size_t* ps) {
+		size_t count = 0;
+
+		unsigned attributes = from.attributes;
+		for (size_t i=0; i<_ATTRIBUTES_OFF_COUNT; ++i)
+			if (attributes & ~to.attributes & _ATTRIBUTES_OFF[i].attributes) {
+				ps[count++] = _ATTRIBUTES_OFF[i].parameter;
+				attributes &= ~_ATTRIBUTES_OFF[i].attributes;
+			}
+		for (size_t i=0; i<_ATTRIBUTES_ON_COUNT; ++i)
+			if (to.attributes & ~attributes & _ATTRIBUTES_ON[i].attributes)
+				ps[count++] = _ATTRIBUTES_ON[i].parameter;
+		if (to.fg != from.fg) count += to.fg.parameters(ps + count, false);
+		if (to.bg != from.bg) count += to.bg.parameters(ps + count, true);
+
+		if (count > 1) {
+			size_t from_default[Rendition::MAX_TRANSITION_PARAMETERS];
+			const size_t from_default_count = sgr_from_default(to, from_default);
+			if (parameters_length(from_default, from_default_count) < parameters_length(ps, count)) {
+				std::copy(from_default, from_default + from_default_count, ps);
+				return from_default_count;
+			}
+		}
+		return count;
+	}
+
+	// Number of bytes needed by encode_transition()
+	const size_t MAX_TRANSITION_LENGTH = ECMA48::C1::LENGTH
+	                                   + Rendition::MAX_TRANSITION_PARAMETERS * (ECMA48::ControlSequence::MAX_DECIMAL_LENGTH + 1)
+	                                   + ECMA48::ControlSequence::MAX_END_DELIMITER_LENGTH;
+
+	// Writes the SGR control sequence moving a terminal from rendition `from` to
+	// rendition `to` at out, and returns the end of the written bytes. Nothing is
+	// written if both are equal.
+	inline char* encode_transition(char* out, const Rendition& from, const Rendition& to) {
+		size_t ps[Rendition::MAX_TRANSITION_PARAMETERS];
+		const size_t count = sgr_transition(from, to, ps);
+		if (count == 0) return out;
+		return ECMA48::ControlSequence::encode(out, "m", ps, count);
+	}
+
+	// Writes the SGR control sequence moving a terminal in any rendition to
+	// rendition `to` at out, and returns the end of the written bytes. It takes
+	// at most MAX_TRANSITION_LENGTH bytes.
+	inline char* encode_rendition(char* out, const Rendition& to) {
+		size_t ps[Rendition::MAX_TRANSITION_PARAMETERS];
+		return ECMA48::ControlSequence::encode(out, "m", ps, sgr_from_default(to, ps));
+	}
+
+	// Parses the parameters of an SGR control sequence, CSI Ps... m, into ps.
+	// Returns false if sequence is not such a sequence or has more than
+	// max_count parameters. Omitted parameters are 0 (§5.4.2).
+	inline bool parse_sgr(const ECMA48::SequenceView& sequence, size_t* ps, size_t max_count, size_t& count) {
+		const char* p = sequence.begin();
+		const char* const end = sequence.end();
+		if (end - p < 3 || p[0] != '\x1b' || p[1] != '[' || end[-1] != 'm')
+			return false;
+
+		count = 0;
+		size_t value = 0;
+		for (p += 2; p != end - 1; ++p) {
+			if (*p >= '0' && *p <= '9') {
+				value = value * 10 + (*p - '0');
+			} else if (*p == ';') {
+				if (count == max_count) return false;
+				ps[count++] = value;
+				value = 0;
+			} else {
+				return false;
+			}
+		}
+		if (count == max_count) return false;
+		ps[count++] = value;
+		return true;
+	}
+
+	// ······
+	// Styles
+
+	// Longest SGR sequence of a Style. Style parameters never exceed 255.
+	const size_t MAX_STYLE_LENGTH = ECMA48::C1::LENGTH + Rendition::MAX_TRANSITION_PARAMETERS * 4;
+
+	// Partial rendition: the colors and attributes it sets or clears, possibly
+	// after a reset. Styles compose with |, later styles taking precedence,
+	// e.g. dye::bold | dye::red | ~dye::blue, and are written as a single SGR
+	// sequence, encoded once when the style is built.
+	class Style {
+		public:
+			constexpr Style()
+				: reset_(false), sets_fg_(false), sets_bg_(false)
+				, values_(), on_(0), off_(0), sequence_()
+				{}
+
+			// Style of attributes turned on by sequence, e.g. dye::bold
+			constexpr Style(unsigned attributes, const ECMA48::SequenceView& sequence)
+				: reset_(false), sets_fg_(false), sets_bg_(false)
+				, values_(), on_(attributes), off_(0), sequence_(sequence)
+				{}
+
+			Style(const ColorManipulator& cm)
+				: Style() {
+				apply(cm.is_background() ? cm.bg().view() : cm.fg().view());
+			}
+
+			Style(const NegatedColorManipulator<ColorManipulator>& cm)
+				: Style() {
+				apply(cm.is_background() ? cm.manipulator().bg().view() : cm.manipulator().fg().view());
+			}
+
+			// Style of an SGR sequence, e.g. ECMA48::not_bold_not_faint. Other
+			// sequences, and unknown parameters, are ignored.
+			explicit Style(const ECMA48::SequenceView& sgr)
+				: Style() {
+				apply(sgr);
+			}
+
+			// Accessors
+
+			bool empty() const { return !reset_ && !sets_fg_ && !sets_bg_ && on_ == 0 && off_ == 0; }
+
+			ECMA48::SequenceView sequence() const { return sequence_.view(); }
+
+			Rendition applied_to(Rendition rendition) const {
+				if (reset_) rendition = Rendition();
+				rendition.attributes = (rendition.attributes & ~off_) | on_;
+				if (sets_fg_) rendition.fg = values_.fg;
+				if (sets_bg_) rendition.bg = values_.bg;
+				return rendition;
+			}
+
+			// Composition
+
+			Style& operator|=(const Style& other) {
+				if (other.reset_) return *this = other;
+				on_  = (on_  & ~other.off_) | other.on_;
+				off_ = (off_ & ~other.on_)  | other.off_;
+				if (other.sets_fg_) {
+					sets_fg_ = true;
+					values_.fg = other.values_.fg;
+				}
+				if (other.sets_bg_) {
+					sets_bg_ = true;
+					values_.bg = other.values_.bg;
+				}
+				encode();
+				return *this;
+			}
+
+		private:
+			void apply(const ECMA48::SequenceView& sgr) {
+				size_t ps[Rendition::MAX_TRANSITION_PARAMETERS];
+				size_t count;
+				if (!parse_sgr(sgr, ps, Rendition::MAX_TRANSITION_PARAMETERS, count)) return;
+
+				for (size_t i=0; i<count; ) {
+					const SGREffect effect = sgr_effect(ps + i, count - i);
+					switch (effect.kind) {
+						case SGREffect::RESET:          *this = Style(); reset_ = true;                      break;
+						case SGREffect::FOREGROUND:     sets_fg_ = true; values_.fg = effect.color;          break;
+						case SGREffect::BACKGROUND:     sets_bg_ = true; values_.bg = effect.color;          break;
+						case SGREffect::ATTRIBUTES_ON:  on_ |= effect.attributes; off_ &= ~effect.attributes; break;
+						case SGREffect::ATTRIBUTES_OFF: off_ |= effect.attributes; on_ &= ~effect.attributes; break;
+						case SGREffect::UNKNOWN:                                                             break;
+					}
+					i += effect.consumed;
+				}
+				encode();
+			}
+
+			void encode() {
+				size_t ps[Rendition::MAX_TRANSITION_PARAMETERS];
+				size_t count = 0;
+				// Attributes turned off after a reset are already off
+				if (reset_) ps[count++] = 0;
+				for (size_t i=0; i<_ATTRIBUTES_OFF_COUNT && !reset_; ++i)
+					if (off_ & _ATTRIBUTES_OFF[i].attributes)
+						ps[count++] = _ATTRIBUTES_OFF[i].parameter;
+				for (size_t i=0; i<_ATTRIBUTES_ON_COUNT; ++i)
+					if (on_ & _ATTRIBUTES_ON[i].attributes)
+						ps[count++] = _ATTRIBUTES_ON[i].parameter;
+				if (sets_fg_) count += values_.fg.parameters(ps + count, false);
+				if (sets_bg_) count += values_.bg.parameters(ps + count, true);
+
+				if (count == 0) {
+					sequence_ = Sequence();
+				} else {
+					char buffer[MAX_TRANSITION_LENGTH];
+					const char* end = ECMA48::ControlSequence::encode(buffer, "m", ps, count);
+					sequence_ = Sequence(buffer, end - buffer);
+				}
+			}
+
+			typedef ECMA48::SequenceBuffer<MAX_STYLE_LENGTH> Sequence;
+
+			bool reset_;
+			bool sets_fg_;
+			bool sets_bg_;
+			Rendition values_; // Colors set, if any
+			unsigned on_;      // Attributes turned on
+			unsigned off_;     // Attributes turned off
+			Sequence sequence_;
+	};
+
+	inline Style operator|(Style a, const Style& b) {
+		return a |= b;
+	}
+
+	inline std::ostream& operator<<(std::ostream& stream, const Style& style) {
+		if (is_colored(stream)) stream << style.sequence();
+		return stream;
+	}
+
+	// Attribute styles, to compose with color manipulators
+
+	constexpr Style              bold(Rendition::BOLD,              ECMA48::bold);
+	constexpr Style             faint(Rendition::FAINT,             ECMA48::faint);
+	constexpr Style            italic(Rendition::ITALIC,            ECMA48::italic);
+	constexpr Style        underlined(Rendition::UNDERLINED,        ECMA48::underlined);
+	constexpr Style     slow_blinking(Rendition::SLOW_BLINKING,     ECMA48::slow_blinking);
+	constexpr Style    rapid_blinking(Rendition::RAPID_BLINKING,    ECMA48::rapid_blinking);
+	constexpr Style          negative(Rendition::NEGATIVE,          ECMA48::negative);
+	constexpr Style         concealed(Rendition::CONCEALED,         ECMA48::concealed);
+	constexpr Style           crossed(Rendition::CROSSED,           ECMA48::crossed);
+	constexpr Style           fraktur(Rendition::FRAKTUR,           ECMA48::fraktur);
+	constexpr Style doubly_underlined(Rendition::DOUBLY_UNDERLINED, ECMA48::doubly_underlined);
+	constexpr Style            framed(Rendition::FRAMED,            ECMA48::framed);
+	constexpr Style         encircled(Rendition::ENCIRCLED,         ECMA48::encircled);
+	constexpr Style         overlined(Rendition::OVERLINED,         ECMA48::overlined);
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                               Styled streams                               //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ––––––––––––––––
+	// Helper functions
+
+	namespace {
+		// Number of bytes of the graphic character at p, UTF-8 encoded, or 0 if p
+		// holds a control character or an invalid or truncated sequence
+		inline size_t graphic_character_length(const char* p, const char* end) {
+			const unsigned char lead = *p;
+			if (lead < 0x80) return lead >= 0x20 && lead != 0x7F ? 1 : 0;
+
+			size_t length;
+			if      (lead >= 0xC2 && lead <= 0xDF) length = 2;
+			else if (lead >= 0xE0 && lead <= 0xEF) length = 3;
+			else if (lead >= 0xF0 && lead <= 0xF4) length = 4;
+			else return 0;
+
+			if (size_t(end - p) < length) return 0;
+			for (size_t i=1; i<length; ++i)
+				if ((static_cast<unsigned char>(p[i]) & 0xC0) != 0x80) return 0;
+			// C1 controls, U+0080 to U+009F
+			if (lead == 0xC2 && static_cast<unsigned char>(p[1]) < 0xA0) return 0;
+			return length;
+		}
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// StyledStream wraps an std::ostream and tracks the rendition requested by
+	// the color manipulators and SGR sequences inserted into it. Nothing is
+	// written for them until text follows; the terminal is then moved from the
+	// rendition it is known to be in to the requested one with a single SGR
+	// sequence holding only the needed parameters. For instance
+	//
+	//     dye::StyledStream out(std::cout);
+	//     out << dye::red << "a" << dye::red << "b" << dye::reset;
+	//
+	// writes ESC[31m once. Scoped manipulators only restore the color they
+	// changed, and only when other text needs it.
+	//
+	// Text written to stream() directly, or control sequences other than SGR, do
+	// not change the tracked rendition. Like on std::ostreams, SGR sequences are
+	// only written to colored streams. The pending rendition is written when the
+	// StyledStream is destroyed.
+	//
+	// On streams whose repeat policy allows it, runs of an identical graphic
+	// character written as text are held back and written as the character
+	// followed by REP when that is shorter, e.g. for bars drawn one colored
+	// space at a time. Text from ESC or a C1 control on is written as is, as is
+	// the next text while a control function it holds is unfinished. Call
+	// commit() before writing to stream() directly.
+
+	class StyledStream {
+		public:
+			explicit StyledStream(std::ostream& stream)
+				: stream_(stream)
+				, requested_()
+				, current_()
+				, current_is_known_(true)
+				, run_length_(0)
+				, run_count_(0)
+				, controls_()
+				{}
+
+			~StyledStream() {
+				commit();
+			}
+
+			StyledStream(const StyledStream&) = delete;
+			StyledStream& operator=(const StyledStream&) = delete;
+
+			std::ostream& stream() const { return stream_; }
+
+			// Rendition of the next text written
+			const Rendition& rendition() const { return requested_; }
+
+			StyledStream& set_rendition(const Rendition& rendition) {
+				requested_ = rendition;
+				return *this;
+			}
+
+			// Writes the pending run of characters, and the SGR sequence moving the
+			// terminal to the requested rendition if it is not in it already
+			StyledStream& commit() {
+				flush_run();
+				transition();
+				return *this;
+			}
+
+			// Text
+
+			StyledStream& write(const char* data, size_t size) {
+				transition();
+				if (!is_repeated(stream_)) {
+					flush_run();
+					stream_.write(data, size);
+					return *this;
+				}
+
+				const char* p = data;
+				const char* const end = data + size;
+				if (!controls_.is_ground()) {
+					// Continuation of a control function cut by the previous write
+					write_controls(p, end);
+					return *this;
+				}
+				while (p != end) {
+					const size_t length = graphic_character_length(p, end);
+					if (length == 0) {
+						flush_run();
+						// What follows ESC or a C1 control may be a control sequence, never
+						// run-length encoded
+						if (*p == '\x1b' || static_cast<unsigned char>(*p) == 0xC2) {
+							write_controls(p, end);
+							break;
+						}
+						stream_.write(p++, 1);
+						continue;
+					}
+					if (run_count_ == 0 || length != run_length_ || std::memcmp(p, run_, length) != 0) {
+						flush_run();
+						std::memcpy(run_, p, length);
+						run_length_ = length;
+					}
+					++run_count_;
+					p += length;
+				}
+				return *this;
+			}
+
+			template <typename T>
+			StyledStream& operator<<(const T& value) {
+				return insert(value, &value);
+			}
+
+			StyledStream& operator<<(const std::string& s) {
+				return insert_sequence(ECMA48::SequenceView(s.data(), s.size()), true);
+			}
+
+			StyledStream& operator<<(const char* s) {
+				// Padded text is formatted by the stream
+				if (stream_.width() != 0) return insert(s, &s);
+				return write(s, std::strlen(s));
+			}
+
+			StyledStream& operator<<(char c) {
+				if (stream_.width() != 0) return insert(c, &c);
+				return write(&c, 1);
+			}
+
+			StyledStream& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+				commit();
+				manipulator(stream_);
+				return *this;
+			}
+
+			// Control sequences
+
+			StyledStream& operator<<(const ECMA48::SequenceView& sequence) {
+				return insert_sequence(sequence, true);
+			}
+
+			template <size_t CAPACITY>
+			StyledStream& operator<<(const ECMA48::SequenceBuffer<CAPACITY>& sequence) {
+				return insert_sequence(sequence.view(), true);
+			}
+
+			// Like on std::ostreams, manipulators are only written to colored streams
+			StyledStream& operator<<(const Manipulator& m) {
+				return insert_sequence(m.control_sequence(), false);
+			}
+
+			// Styles and color manipulators
+
+			StyledStream& operator<<(const Style& style) {
+				requested_ = style.applied_to(requested_);
+				return *this;
+			}
+
+			StyledStream& operator<<(const ColorManipulator& cm) {
+				return apply_color(cm, false);
+			}
+
+			StyledStream& operator<<(const NegatedColorManipulator<ColorManipulator>& cm) {
+				return apply_color(cm.manipulator(), true);
+			}
+
+			// Manipulators of both color depths are tracked in the stream's depth
+
+			StyledStream& operator<<(const ColormapEntry& entry) {
+				return apply_color(entry.manipulator(is_24bit(stream_)), false);
+			}
+
+			StyledStream& operator<<(const NegatedColorManipulator<ColormapEntry>& entry) {
+				return apply_color(entry.manipulator().manipulator(is_24bit(stream_)), true);
+			}
+
+			StyledStream& operator<<(const ColormapBlend& blend) {
+				return apply_color(blend.manipulator(is_24bit(stream_)), false);
+			}
+
+			template <typename CM, typename ObjectType>
+			StyledStream& operator<<(const ScopedColorManipulator<CM,ObjectType>& scoped) {
+				return insert_scoped(scoped, scoped.manipulator(), false, scoped.object());
+			}
+
+			template <typename CM, typename ObjectType>
+			StyledStream& operator<<(const NegatedColorManipulator< ScopedColorManipulator<CM,ObjectType> >& negated) {
+				const ScopedColorManipulator<CM,ObjectType>& scoped = negated.manipulator();
+				return insert_scoped(negated, scoped.manipulator(), true, scoped.object());
+			}
+
+		private:
+			StyledStream& apply_color(const ColorManipulator& cm, bool inverted) {
+				const bool background = cm.is_background(inverted);
+				return insert_sequence(background ? cm.bg().view() : cm.fg().view(), false);
+			}
+
+			// Writes the SGR sequence moving the terminal to the requested rendition,
+			// after the pending run of characters
+			void transition() {
+				if (current_is_known_ && current_ == requested_) return;
+				if (is_colored(stream_)) {
+					flush_run();
+					char buffer[MAX_TRANSITION_LENGTH];
+					const char* end = current_is_known_ ? encode_transition(buffer, current_, requested_)
+					                                    : encode_rendition(buffer, requested_);
+					stream_.write(buffer, end - buffer);
+				}
+				current_ = requested_;
+				current_is_known_ = true;
+			}
+
+			void write_controls(const char* p, const char* end) {
+				flush_run();
+				stream_.write(p, end - p);
+				controls_.feed(p, end - p, [](const char*, size_t) {});
+			}
+
+			void flush_run() {
+				if (run_count_ == 0) return;
+				if (repetition_is_shorter(run_length_, run_count_)) {
+					stream_.write(run_, run_length_);
+					char buffer[ECMA48::ControlSequence::MAX_LENGTH];
+					stream_.write(buffer, ECMA48::ControlSequence::REP.encode(buffer, run_count_ - 1) - buffer);
+				} else {
+					for (size_t i=0; i<run_count_; ++i) stream_.write(run_, run_length_);
+				}
+				run_count_ = 0;
+			}
+
+			// SGR sequences update the requested rendition. Other sequences are
+			// written, if always_written or if the stream is colored.
+			StyledStream& insert_sequence(const ECMA48::SequenceView& sequence, bool always_written) {
+				size_t ps[Rendition::MAX_TRANSITION_PARAMETERS];
+				size_t count;
+				if (!parse_sgr(sequence, ps, Rendition::MAX_TRANSITION_PARAMETERS, count)) {
+					if (always_written || is_colored(stream_)) write(sequence.data(), sequence.size());
+					return *this;
+				}
+
+				Rendition requested = requested_;
+				if (requested.apply(ps, count)) {
+					requested_ = requested;
+					return *this;
+				}
+
+				// Parameters which are not tracked, e.g. fonts: the sequence is written
+				// as is, after the pending rendition
+				commit();
+				if (is_colored(stream_)) stream_.write(sequence.data(), sequence.size());
+				current_.apply(ps, count);
+				requested_ = current_;
+				return *this;
+			}
+
+			// Scoped manipulators of color manipulators are tracked: the color is set
+			// for the object and then restored. Others are written as usual.
+			template <typename SCOPED, typename ObjectType>
+			StyledStream& insert_scoped(const SCOPED&, const ColorManipulator& cm, bool inverted,
+			                            const ObjectType& object) {
+				return insert_tracked_scoped(cm, inverted, object);
+			}
+
+			template <typename SCOPED, typename ObjectType>
+			StyledStream& insert_scoped(const SCOPED&, const NegatedColorManipulator<ColorManipulator>& cm, bool inverted,
+			                            const ObjectType& object) {
+				return insert_tracked_scoped(cm.manipulator(), !inverted, object);
+			}
+
+			template <typename SCOPED, typename ObjectType>
+			StyledStream& insert_scoped(const SCOPED&, const ColormapEntry& entry, bool inverted,
+			                            const ObjectType& object) {
+				return insert_tracked_scoped(entry.manipulator(is_24bit(stream_)), inverted, object);
+			}
+
+			template <typename SCOPED, typename ObjectType>
+			StyledStream& insert_scoped(const SCOPED&, const NegatedColorManipulator<ColormapEntry>& entry, bool inverted,
+			                            const ObjectType& object) {
+				return insert_tracked_scoped(entry.manipulator().manipulator(is_24bit(stream_)), !inverted, object);
+			}
+
+			template <typename SCOPED, typename ObjectType>
+			StyledStream& insert_scoped(const SCOPED&, const ColormapBlend& blend, bool inverted,
+			                            const ObjectType& object) {
+				return insert_tracked_scoped(blend.manipulator(is_24bit(stream_)), inverted, object);
+			}
+
+			template <typename SCOPED, typename M, typename ObjectType>
+			StyledStream& insert_scoped(const SCOPED& scoped, const M&, bool, const ObjectType&) {
+				return insert(scoped, &scoped);
+			}
+
+			template <typename ObjectType>
+			StyledStream& insert_tracked_scoped(const ColorManipulator& cm, bool inverted, const ObjectType& object) {
+				const Rendition saved = requested_;
+				const bool background = cm.is_background(inverted);
+				apply_color(cm, inverted);
+				*this << object;
+				if (background) requested_.bg = saved.bg;
+				else            requested_.fg = saved.fg;
+				return *this;
+			}
+
+			template <typename T, typename CM>
+			StyledStream& insert(const T& cm, const ColorManipulatorExpression<CM>*) {
+				// Other expressions are written as usual, leaving the terminal in an
+				// unknown rendition
+				commit();
+				stream_ << cm;
+				current_is_known_ = false;
+				return *this;
+			}
+
+			template <typename T>
+			StyledStream& insert(const T& value, const void*) {
+				commit();
+				stream_ << value;
+				return *this;
+			}
+
+			std::ostream& stream_;
+			Rendition requested_;
+			Rendition current_;
+			bool current_is_known_;
+
+			// Pending run of run_count_ identical characters of run_length_ bytes
+			char run_[4];
+			size_t run_length_;
+			size_t run_count_;
+
+			// Control functions written as is, to tell whether one continues in the
+			// next write
+			Stripper controls_;
+	};
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                           File descriptor writers                          //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ––––––––––––––––
+	// Helper functions
+
+	// Shared by all translation units, as the writers' members are
+	namespace detail {
+		// Output operators of writers, which provide write(data, size) and
+		// is_colored(). Writers take the same manipulators and expressions as
+		// std::ostreams, and format text and numbers as std::ostream does by
+		// default, without sentries, locales or virtual calls.
+		template <typename WRITER>
+		class BasicWriter {
+			public:
+				// Text
+
+				WRITER& operator<<(const char* s) { return derived().write(s, std::strlen(s)); }
+				WRITER& operator<<(const std::string& s) { return derived().write(s.data(), s.size()); }
+				WRITER& operator<<(char c) { return derived().write(&c, 1); }
+				WRITER& operator<<(signed char c) { return *this << char(c); }
+				WRITER& operator<<(unsigned char c) { return *this << char(c); }
+
+				// Numbers
+
+				WRITER& operator<<(int v)                { return write_signed(v); }
+				WRITER& operator<<(long v)               { return write_signed(v); }
+				WRITER& operator<<(long long v)          { return write_signed(v); }
+				WRITER& operator<<(unsigned v)           { return write_unsigned(v); }
+				WRITER& operator<<(unsigned long v)      { return write_unsigned(v); }
+				WRITER& operator<<(unsigned long long v) { return write_unsigned(v); }
+
+				WRITER& operator<<(double v) {
+					char buffer[32];
+					const int length = std::snprintf(buffer, sizeof(buffer), "%g", v);
+					return derived().write(buffer, length);
+				}
+
+				WRITER& operator<<(long double v) {
+					char buffer[64];
+					const int length = std::snprintf(buffer, sizeof(buffer), "%Lg", v);
+					return derived().write(buffer, length);
+				}
+
+				// Control sequences are always written, manipulators and styles only if
+				// the writer is colored
+
+				WRITER& operator<<(const ECMA48::SequenceView& sequence) {
+					const size_t styling = derived().begin_styling();
+					derived().write(sequence.data(), sequence.size());
+					derived().end_styling(styling);
+					return derived();
+				}
+
+				template <size_t CAPACITY>
+				WRITER& operator<<(const ECMA48::SequenceBuffer<CAPACITY>& sequence) {
+					return *this << sequence.view();
+				}
+
+				WRITER& operator<<(const Manipulator& m) {
+					if (!derived().is_colored()) return derived();
+					const size_t styling = derived().begin_styling();
+					m.manipulate(derived());
+					derived().end_styling(styling);
+					return derived();
+				}
+
+				template <typename CM>
+				WRITER& operator<<(const ColorManipulatorExpression<CM>& cm) {
+					if (!derived().is_colored()) return static_cast<const CM&>(cm).uncolored(derived());
+					const size_t styling = derived().begin_styling();
+					cm.manipulate(derived());
+					derived().end_styling(styling);
+					return derived();
+				}
+
+				WRITER& operator<<(const Style& style) {
+					if (derived().is_colored() && !style.empty()) *this << style.sequence();
+					return derived();
+				}
+
+				// Manipulators of writers, e.g. dye::flush
+
+				WRITER& operator<<(WRITER& (*manipulator)(WRITER&)) {
+					return manipulator(derived());
+				}
+
+				// Called around the output of control sequences, manipulators and
+				// expressions. Writers closing what their output changed, like Line,
+				// hide them: begin_styling() returns a token given to end_styling().
+				size_t begin_styling() { return 0; }
+				void end_styling(size_t) {}
+
+			private:
+				WRITER& derived() { return static_cast<WRITER&>(*this); }
+
+				template <typename T>
+				WRITER& write_signed(T v) {
+					if (v >= 0) return write_unsigned((unsigned long long)v);
+					*this << '-';
+					// Negated in unsigned arithmetic, which is defined for the minimum
+					return write_unsigned(0ULL - (unsigned long long)v);
+				}
+
+				WRITER& write_unsigned(unsigned long long v) {
+					char buffer[std::numeric_limits<unsigned long long>::digits10 + 1];
+					char* end = buffer + sizeof(buffer);
+					char* p = end;
+					do {
+						*--p = char('0' + v % 10);
+						v /= 10;
+					} while (v != 0);
+					return derived().write(p, end - p);
+				}
+		};
+
+		// Whether writing to fd is colored under policy, isatty() being queried
+		// once per process for stdout and stderr
+		inline bool fd_is_colored(int fd, ColorPolicy policy) {
+			switch (policy) {
+				case ALWAYS_COLOR: return true;
+				case NEVER_COLOR:  return false;
+				default:
+					return fd == STDOUT_FILENO ? stdout_is_tty()
+					     : fd == STDERR_FILENO ? stderr_is_tty()
+					     : isatty(fd);
+			}
+		}
+
+		// Writes all chunks to fd, restarting after partial writes and EINTR.
+		// Returns 0, or the errno of the failed write.
+		inline int write_all(int fd, iovec* chunks, int count) {
+			while (count > 0) {
+				const ssize_t written = ::writev(fd, chunks, count);
+				if (written < 0) {
+					if (errno == EINTR) continue;
+					return errno;
+				}
+				size_t remaining = written;
+				while (count > 0 && remaining >= chunks->iov_len) {
+					remaining -= chunks->iov_len;
+					++chunks;
+					--count;
+				}
+				if (count > 0) {
+					chunks->iov_base = static_cast<char*>(chunks->iov_base) + remaining;
+					chunks->iov_len -= remaining;
+				}
+			}
+			return 0;
+		}
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// FdWriter is an output sink writing to a file descriptor with write(2),
+	// through a user-space buffer, without std::ostream sentries, locales or
+	// virtual streambuf calls. It takes the same manipulators and expressions as
+	// std::ostreams:
+	//
+	//     dye::FdWriter out(STDOUT_FILENO);
+	//     out << dye::red("error") << ": " << count << " files\n";
+	//
+	// Payloads of at least half the buffer are not copied: they are written
+	// along with the buffered bytes by a single writev(2). Numbers are written
+	// as with the default format of std::ostream.
+	//
+	// Each writer has its own color policy. With AUTO_COLOR, the default, it is
+	// colored if its file descriptor is a terminal, which is checked once, on
+	// construction. Write errors other than EINTR make the writer fail: good()
+	// returns false, error() returns errno, and further output is discarded.
+
+	class FdWriter : public detail::BasicWriter<FdWriter> {
+		public:
+			static const size_t DEFAULT_CAPACITY = 64 * 1024;
+
+			explicit FdWriter(int fd, size_t capacity = DEFAULT_CAPACITY)
+				: fd_(fd)
+				, buffer_(new char[capacity])
+				, capacity_(capacity)
+				, size_(0)
+				, policy_(AUTO_COLOR)
+				, is_tty_(isatty(fd))
+				, error_(0)
+				{}
+
+			~FdWriter() {
+				flush();
+			}
+
+			FdWriter(const FdWriter&) = delete;
+			FdWriter& operator=(const FdWriter&) = delete;
+
+			// Accessors
+
+			int fd() const { return fd_; }
+			bool good() const { return error_ == 0; }
+			int error() const { return error_; }
+
+			// Color policy
+
+			void set_color_policy(ColorPolicy policy) { policy_ = policy; }
+			ColorPolicy color_policy() const { return policy_; }
+
+			bool is_colored() const {
+				switch (policy_) {
+					case ALWAYS_COLOR: return true;
+					case NEVER_COLOR:  return false;
+					default:           return is_tty_;
+				}
+			}
+
+			// Output
+
+			FdWriter& write(const char* data, size_t size) {
+				if (size >= capacity_ / 2) {
+					iovec chunks[2] = {
+						{ buffer_.get(),         size_ },
+						{ const_cast<char*>(data), size }
+					};
+					write_all(chunks, 2);
+					size_ = 0;
+				} else if (size <= capacity_ - size_) {
+					std::memcpy(buffer_.get() + size_, data, size);
+					size_ += size;
+				} else {
+					flush();
+					std::memcpy(buffer_.get(), data, size);
+					size_ = size;
+				}
+				return *this;
+			}
+
+			// Writes the buffered bytes to the file descriptor
+			FdWriter& flush() {
+				if (size_ == 0) return *this;
+				iovec chunk = { buffer_.get(), size_ };
+				write_all(&chunk, 1);
+				size_ = 0;
+				return *this;
+			}
+
+		private:
+			void write_all(iovec* chunks, int count) {
+				if (error_ == 0) error_ = detail::write_all(fd_, chunks, count);
+			}
+
+			int fd_;
+			std::unique_ptr<char[]> buffer_;
+			size_t capacity_;
+			size_t size_;
+			ColorPolicy policy_;
+			bool is_tty_;
+			int error_;
+	};
+
+	inline FdWriter& flush(FdWriter& writer) {
+		return writer.flush();
+	}
+
+	inline bool is_colored(const FdWriter& writer) {
+		return writer.is_colored();
+	}
+
+	// ·····
+	// Lines
+
+	// Line assembles one line of styled output and writes it to a file
+	// descriptor with a single write(2) when it is destroyed, so that lines
+	// written by concurrent threads never interleave, escape sequences included:
+	//
+	//     dye::Line(STDOUT_FILENO) << dye::red("ERROR") << ": " << message << "\n";
+	//
+	// The line is built in a buffer owned by the calling thread, whose capacity
+	// is reused by its next lines: no lock is taken and, once the buffer has
+	// grown, nothing is allocated. If the control sequences written to a
+	// colored line leave a color or an attribute set, as dye::red << "text"
+	// does, the line ends with SGR 0, before its final newline if any.
+	//
+	// A single write(2) is not split on terminals, pipes (up to PIPE_BUF bytes)
+	// and files opened with O_APPEND. With AUTO_COLOR, isatty() is queried once
+	// per process for stdout and stderr, and for each line on other descriptors.
+
+	class Line : public detail::BasicWriter<Line> {
+		public:
+			explicit Line(int fd, ColorPolicy policy = AUTO_COLOR)
+				: fd_(fd)
+				, is_colored_(detail::fd_is_colored(fd, policy))
+				, styling_depth_(0)
+				, buffer_(acquire_buffer())
+				{
+					buffer_->text.clear();
+				}
+
+			~Line() {
+				publish();
+				buffer_->in_use = false;
+				if (buffer_->is_owned) delete buffer_;
+			}
+
+			Line(const Line&) = delete;
+			Line& operator=(const Line&) = delete;
+
+			bool is_colored() const { return is_colored_; }
+
+			Line& write(const char* data, size_t size) {
+				buffer_->text.append(data, size);
+				return *this;
+			}
+
+			// The rendition is tracked through the bytes of the outermost control
+			// sequences, manipulators and expressions only, as they are written
+			size_t begin_styling() {
+				++styling_depth_;
+				return buffer_->text.size();
+			}
+
+			void end_styling(size_t start) {
+				if (--styling_depth_ != 0) return;
+				const std::string& text = buffer_->text;
+				ECMA48::Tokenizer tokenizer;
+				tokenizer.feed(text.data() + start, text.size() - start, [this](const ECMA48::Token& token) {
+					rendition_.apply(token);
+				});
+			}
+
+			// Writes the line, closed by SGR 0 if it leaves a color or an attribute
+			// set, and starts a new one. Returns 0, or the errno of the failed write.
+			int publish() {
+				std::string& text = buffer_->text;
+				if (is_colored_ && !rendition_.is_default()) {
+					const ECMA48::SequenceView& reset = ECMA48::reset;
+					const size_t position = !text.empty() && text[text.size() - 1] == '\n' ? text.size() - 1 : text.size();
+					text.insert(position, reset.data(), reset.size());
+				}
+				rendition_ = Rendition();
+				if (text.empty()) return 0;
+
+				iovec chunk = { &text[0], text.size() };
+				const int error = detail::write_all(fd_, &chunk, 1);
+				text.clear();
+				return error;
+			}
+
+		private:
+			struct Buffer {
+				std::string text;
+				bool in_use;
+				bool is_owned; // By a Line, rather than by its thread
+			};
+
+			// The calling thread's buffer, or a new one for lines built while it
+			// is in use, e.g. by an object written to another line
+			static Buffer* acquire_buffer() {
+				static thread_local Buffer thread_buffer = { std::string(), false, false };
+				if (thread_buffer.in_use) {
+					Buffer* buffer = new Buffer();
+					buffer->in_use = true;
+					buffer->is_owned = true;
+					return buffer;
+				}
+				thread_buffer.in_use = true;
+				return &thread_buffer;
+			}
+
+			int fd_;
+			bool is_colored_;
+			Rendition rendition_;  // Selected by the line's styles so far
+			size_t styling_depth_; // Of expressions written by expressions
+			Buffer* buffer_;
+	};
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                            Asynchronous logging                            //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// Shared by all translation units, as AsyncLogger's members are
+	namespace detail {
+		// Single-producer single-consumer ring of log records: a header naming
+		// the style of the record, then its text, padded to the header's size.
+		// Positions only grow; they are reduced modulo the capacity, a power of 2.
+		class LogRing {
+			public:
+				enum Kind {
+					UNSTYLED = 0,
+					COLOR    = 1, // handle is a const ColorManipulator*
+					STYLE    = 2, // handle is a const Style*
+					PADDING  = 3  // Skips the rest of the buffer
+				};
+
+				struct Header {
+					const void* handle;
+					uint32_t size;
+					uint32_t kind;
+				};
+
+				explicit LogRing(size_t capacity)
+					: buffer_(new char[capacity])
+					, capacity_(capacity)
+					, head_(0)
+					, cached_tail_(0)
+					, tail_(0)
+					, dropped_(0)
+					, closed_(false)
+					{
+						assert(capacity >= 2 * sizeof(Header) && (capacity & (capacity - 1)) == 0);
+					}
+
+				// Producer: copies the record into the ring, or counts it as dropped and
+				// returns false if it does not fit
+				bool push(Kind kind, const void* handle, const char* text, size_t size) {
+					const size_t record = sizeof(Header) + padded(size);
+					const size_t head = head_.load(std::memory_order_relaxed);
+					size_t offset = head & (capacity_ - 1);
+					const size_t contiguous = capacity_ - offset;
+					const size_t needed = record <= contiguous ? record : contiguous + record;
+					if (record > capacity_ / 2 || !has_room(head, needed)) {
+						dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+						return false;
+					}
+
+					size_t end = head + record;
+					if (record > contiguous) {
+						const Header padding = { 0, 0, PADDING };
+						std::memcpy(buffer_.get() + offset, &padding, sizeof(Header));
+						offset = 0;
+						end += contiguous;
+					}
+					const Header header = { handle, uint32_t(size), uint32_t(kind) };
+					std::memcpy(buffer_.get() + offset, &header, sizeof(Header));
+					std::memcpy(buffer_.get() + offset + sizeof(Header), text, size);
+					head_.store(end, std::memory_order_release);
+					return true;
+				}
+
+				// Consumer: calls f(header, text) for every record, and returns their
+				// number
+				template <typename F>
+				size_t drain(F f) {
+					size_t tail = tail_.load(std::memory_order_relaxed);
+					const size_t head = head_.load(std::memory_order_acquire);
+					size_t count = 0;
+					while (tail != head) {
+						const size_t offset = tail & (capacity_ - 1);
+						Header header;
+						std::memcpy(&header, buffer_.get() + offset, sizeof(Header));
+						if (header.kind == PADDING) {
+							tail += capacity_ - offset;
+							continue;
+						}
+						f(header, buffer_.get() + offset + sizeof(Header));
+						tail += sizeof(Header) + padded(header.size);
+						++count;
+					}
+					tail_.store(tail, std::memory_order_release);
+					return count;
+				}
+
+				// Bytes waiting to be drained
+				size_t depth() const {
+					const size_t tail = tail_.load(std::memory_order_acquire);
+					return head_.load(std::memory_order_acquire) - tail;
+				}
+
+				uint64_t dropped() const {
+					return dropped_.load(std::memory_order_relaxed);
+				}
+
+				// Set when the logger owning the ring is destroyed, for producers to
+				// release their reference to it
+				void close() { closed_.store(true, std::memory_order_release); }
+				bool is_closed() const { return closed_.load(std::memory_order_acquire); }
+
+			private:
+				static size_t padded(size_t size) {
+					return (size + sizeof(Header) - 1) & ~(sizeof(Header) - 1);
+				}
+
+				bool has_room(size_t head, size_t needed) {
+					if (needed <= capacity_ - (head - cached_tail_)) return true;
+					cached_tail_ = tail_.load(std::memory_order_acquire);
+					return needed <= capacity_ - (head - cached_tail_);
+				}
+
+				std::unique_ptr<char[]> buffer_;
+				const size_t capacity_;
+
+				// Producer and consumer positions on separate cache lines
+				std::atomic<size_t> head_;
+				size_t cached_tail_; // Producer's last view of tail_
+				char producer_padding_[64];
+				std::atomic<size_t> tail_;
+				char consumer_padding_[64];
+				std::atomic<uint64_t> dropped_;
+				std::atomic<bool> closed_;
+		};
+
+		inline uint64_t next_logger_id() {
+			static std::atomic<uint64_t> id(0);
+			return ++id;
+		}
+	}
+
+	// AsyncLogger writes log records to a file descriptor from a background
+	// thread. Each producer thread pushes its records into its own lock-free
+	// ring: a style handle and a copy of the text, without formatting or system
+	// calls. The background thread drains the rings, writes the precomputed SGR
+	// sequences of the styles, and flushes each batch with FdWriter. Consecutive
+	// records of one style share its sequences. When the rings are empty, the
+	// thread sleeps until the next record: a producer only takes a lock to wake
+	// it up.
+	//
+	//     static const dye::ColorManipulator warning = ~dye::yellow;
+	//     dye::AsyncLogger log(STDERR_FILENO);
+	//     log.log(&warning, "disk almost full\n");
+	//
+	// Style handles are pointers: they must outlive the logger, e.g. dye::red,
+	// Style constants or other static objects. Records which do not fit in
+	// their thread's ring, or longer than half of it, are dropped and counted.
+	// Records of one thread are written in order. The logger writes all records
+	// logged before its destruction, then closes the rings; each producer
+	// thread releases the closed rings it holds on its next record.
+	//
+	// The final newline of a styled record is written after the sequence
+	// resetting the style, if the next record does not share it, so that lines
+	// do not start with control sequences.
+
+	class AsyncLogger {
+		public:
+			static const size_t DEFAULT_RING_CAPACITY = 64 * 1024;
+
+			// ring_capacity must be a power of 2
+			explicit AsyncLogger(int fd, ColorPolicy policy = AUTO_COLOR,
+			                     size_t ring_capacity = DEFAULT_RING_CAPACITY)
+				: writer_(fd)
+				, ring_capacity_(ring_capacity)
+				, id_(detail::next_logger_id())
+				, open_kind_(detail::LogRing::UNSTYLED)
+				, open_handle_(0)
+				, has_pending_newline_(false)
+				, stopping_(false)
+				, sleeping_(false)
+				{
+					writer_.set_color_policy(policy);
+					thread_ = std::thread(&AsyncLogger::run, this);
+				}
+
+			~AsyncLogger() {
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					stopping_ = true;
+				}
+				wakeup_.notify_one();
+				thread_.join();
+				for (size_t i=0; i<rings_.size(); ++i) rings_[i]->close();
+			}
+
+			AsyncLogger(const AsyncLogger&) = delete;
+			AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+			// Producers
+
+			bool log(const char* text, size_t size) {
+				return wake(ring().push(detail::LogRing::UNSTYLED, 0, text, size));
+			}
+
+			bool log(const ColorManipulator* style, const char* text, size_t size) {
+				return wake(ring().push(detail::LogRing::COLOR, style, text, size));
+			}
+
+			bool log(const Style* style, const char* text, size_t size) {
+				return wake(ring().push(detail::LogRing::STYLE, style, text, size));
+			}
+
+			bool log(const std::string& text) {
+				return log(text.data(), text.size());
+			}
+
+			bool log(const ColorManipulator* style, const std::string& text) {
+				return log(style, text.data(), text.size());
+			}
+
+			bool log(const Style* style, const std::string& text) {
+				return log(style, text.data(), text.size());
+			}
+
+			// Statistics, from any thread
+
+			// Bytes of records waiting to be written
+			size_t queue_depth() const {
+				std::lock_guard<std::mutex> lock(mutex_);
+				size_t depth = 0;
+				for (size_t i=0; i<rings_.size(); ++i) depth += rings_[i]->depth();
+				return depth;
+			}
+
+			// Records dropped because their ring was full
+			uint64_t dropped() const {
+				std::lock_guard<std::mutex> lock(mutex_);
+				uint64_t dropped = 0;
+				for (size_t i=0; i<rings_.size(); ++i) dropped += rings_[i]->dropped();
+				return dropped;
+			}
+
+		private:
+			// Ring of the calling thread, created on its first record. Rings of
+			// destroyed loggers are released on the way, so that a thread only holds
+			// the rings of live loggers, and of those destroyed since its last record.
+			detail::LogRing& ring() {
+				struct ThreadRing {
+					uint64_t logger_id;
+					std::shared_ptr<detail::LogRing> ring;
+				};
+				static thread_local std::vector<ThreadRing> thread_rings;
+
+				detail::LogRing* found = 0;
+				for (size_t i=0; i<thread_rings.size(); ) {
+					if (thread_rings[i].ring->is_closed()) {
+						thread_rings[i] = std::move(thread_rings.back());
+						thread_rings.pop_back();
+						continue;
+					}
+					if (thread_rings[i].logger_id == id_) found = thread_rings[i].ring.get();
+					++i;
+				}
+				if (found != 0) return *found;
+
+				const ThreadRing thread_ring = { id_, std::make_shared<detail::LogRing>(ring_capacity_) };
+				thread_rings.push_back(thread_ring);
+				std::lock_guard<std::mutex> lock(mutex_);
+				rings_.push_back(thread_ring.ring);
+				return *rings_.back();
+			}
+
+			// Wakes the background thread if it sleeps, after a record was pushed.
+			// Exchanges of sleeping_ are totally ordered: either the producer sees
+			// the flag park() set, or park() sees the record pushed before.
+			bool wake(bool pushed) {
+				if (!pushed) return false;
+				if (sleeping_.exchange(false, std::memory_order_acq_rel)) {
+					std::lock_guard<std::mutex> lock(mutex_);
+					wakeup_.notify_one();
+				}
+				return true;
+			}
+
+			// Background thread
+			void run() {
+				std::vector<detail::LogRing*> rings;
+				std::unique_lock<std::mutex> lock(mutex_);
+				for (;;) {
+					rings.clear();
+					for (size_t i=0; i<rings_.size(); ++i) rings.push_back(rings_[i].get());
+					const bool stopping = stopping_;
+					lock.unlock();
+
+					size_t count = 0;
+					for (size_t i=0; i<rings.size(); ++i)
+						count += rings[i]->drain([this](const detail::LogRing::Header& header, const char* text) {
+							write(header, text);
+						});
+					if (count != 0) {
+						close_style();
+						writer_.flush();
+					}
+
+					lock.lock();
+					if (stopping) return;
+					if (count == 0) park(lock);
+				}
+			}
+
+			// Sleeps until a producer pushes a record or the logger is destroyed,
+			// unless a record was pushed since the rings were drained
+			void park(std::unique_lock<std::mutex>& lock) {
+				sleeping_.exchange(true, std::memory_order_acq_rel);
+				bool is_empty = true;
+				for (size_t i=0; i<rings_.size() && is_empty; ++i) is_empty = rings_[i]->depth() == 0;
+				if (is_empty && !stopping_) wakeup_.wait(lock);
+				sleeping_.store(false, std::memory_order_relaxed);
+			}
+
+			void write(const detail::LogRing::Header& header, const char* text) {
+				if (header.kind != open_kind_ || header.handle != open_handle_) {
+					close_style();
+					open_kind_ = header.kind;
+					open_handle_ = header.handle;
+					if (header.kind == detail::LogRing::COLOR)
+						writer_ << *static_cast<const ColorManipulator*>(header.handle);
+					else if (header.kind == detail::LogRing::STYLE)
+						writer_ << *static_cast<const Style*>(header.handle);
+				} else {
+					write_pending_newline();
+				}
+
+				// The final newline of a styled record waits for the next record
+				size_t size = header.size;
+				if (open_kind_ != detail::LogRing::UNSTYLED && size != 0 && text[size - 1] == '\n') {
+					--size;
+					has_pending_newline_ = true;
+				}
+				writer_.write(text, size);
+			}
+
+			void write_pending_newline() {
+				if (has_pending_newline_) writer_ << '\n';
+				has_pending_newline_ = false;
+			}
+
+			// Resets what the style of the previous records changed, before their
+			// final newline
+			void close_style() {
+				if (writer_.is_colored() && open_kind_ == detail::LogRing::COLOR) {
+					const ColorManipulator& cm = *static_cast<const ColorManipulator*>(open_handle_);
+					writer_ << (cm.is_background() ? ECMA48::default_background : ECMA48::default_color);
+				} else if (writer_.is_colored() && open_kind_ == detail::LogRing::STYLE) {
+					writer_ << ECMA48::reset;
+				}
+				open_kind_ = detail::LogRing::UNSTYLED;
+				open_handle_ = 0;
+				write_pending_newline();
+			}
+
+			FdWriter writer_;            // Background thread only
+			const size_t ring_capacity_;
+			const uint64_t id_;          // Unlike addresses, never reused
+
+			// Style of the last records written, reset at the end of each batch
+			uint32_t open_kind_;
+			const void* open_handle_;
+			bool has_pending_newline_;   // Final newline of the last record, not written yet
+
+			mutable std::mutex mutex_;   // Guards rings_ and stopping_
+			std::vector< std::shared_ptr<detail::LogRing> > rings_;
+			std::condition_variable wakeup_;
+			bool stopping_;
+			std::atomic<bool> sleeping_; // The background thread waits for wakeup_
+			std::thread thread_;
+	};
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                               Cursor movement                              //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ––––––––––––––––
+	// Helper functions
+
+	namespace {
+		// Up to this many BS or LF are no longer than the equivalent CUB or CNL
+		const size_t MAX_REPEATED_MOVES = 3;
+
+		// Shortest of the byte sequences it is given
+		class ShortestMovement {
+			public:
+				ShortestMovement()
+					: length_(std::numeric_limits<size_t>::max())
+					{}
+
+				// Considers the bytes of a first movement followed by a second one
+				void consider(const char* first, const char* first_end,
+				              const char* second, const char* second_end) {
+					const size_t first_length = first_end - first;
+					const size_t length = first_length + (second_end - second);
+					if (length >= length_) return;
+					std::copy(first, first_end, bytes_);
+					std::copy(second, second_end, bytes_ + first_length);
+					length_ = length;
+				}
+
+				char* write(char* out) const {
+					return std::copy(bytes_, bytes_ + length_, out);
+				}
+
+			private:
+				char bytes_[2 * ECMA48::ControlSequence::MAX_LENGTH];
+				size_t length_;
+		};
+
+		inline char* repeat(char* out, char c, size_t n) {
+			return std::fill_n(out, n, c);
+		}
+
+		// Shortest movement from column x to column to_x, on the same line
+		inline char* encode_column_movement(char* out, size_t x, size_t to_x) {
+			namespace CS = ECMA48::ControlSequence;
+			if (x == to_x) return out;
+
+			const char* const none = out;
+			char candidate[CS::MAX_LENGTH];
+			ShortestMovement shortest;
+			if (to_x == 0)
+				shortest.consider(none, none, candidate, repeat(candidate, '\r', 1));
+			if (to_x < x && x - to_x <= MAX_REPEATED_MOVES)
+				shortest.consider(none, none, candidate, repeat(candidate, '\b', x - to_x));
+			if (to_x > x)
+				shortest.consider(none, none, candidate, CS::CUF.encode(candidate, to_x - x));
+			else
+				shortest.consider(none, none, candidate, CS::CUB.encode(candidate, x - to_x));
+			shortest.consider(none, none, candidate, CS::CHA.encode(candidate, to_x + 1));
+			return shortest.write(out);
+		}
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// Writes at out the shortest bytes moving the cursor from column x of line y
+	// to column to_x of line to_y, and returns their end. Positions are 0-based,
+	// within the screen, and the cursor must not be pending an automatic wrap
+	// (after a character was written in the last column). out must have room for
+	// ECMA48::ControlSequence::MAX_LENGTH bytes: the movement is never longer
+	// than CUP.
+	//
+	// Candidates are CUP alone, or a vertical movement (none, CUU/CUD, VPA, CNL,
+	// CPL, or CR followed by a few LF) followed by a horizontal one (none, CR, a
+	// few BS, CUF/CUB, CHA). HPR, VPR and HVP encode as long as CUF, CUD and CUP.
+	// LF is only used after CR, so that it lands in the first column whether or
+	// not the terminal or the tty turns it into CR LF.
+	inline char* encode_cursor_movement(char* out, size_t x, size_t y, size_t to_x, size_t to_y) {
+		namespace CS = ECMA48::ControlSequence;
+
+		char vertical[CS::MAX_LENGTH];
+		char horizontal[CS::MAX_LENGTH];
+		char* vertical_end;
+		ShortestMovement shortest;
+
+		// Vertical movements keeping the column
+		if (y == to_y) {
+			shortest.consider(vertical, vertical, horizontal, encode_column_movement(horizontal, x, to_x));
+		} else {
+			char* const horizontal_end = encode_column_movement(horizontal, x, to_x);
+			vertical_end = to_y > y ? CS::CUD.encode(vertical, to_y - y) : CS::CUU.encode(vertical, y - to_y);
+			shortest.consider(vertical, vertical_end, horizontal, horizontal_end);
+			vertical_end = CS::VPA.encode(vertical, to_y + 1);
+			shortest.consider(vertical, vertical_end, horizontal, horizontal_end);
+		}
+
+		// Vertical movements to the first column
+		if (y != to_y) {
+			char* const horizontal_end = encode_column_movement(horizontal, 0, to_x);
+			vertical_end = to_y > y ? CS::CNL.encode(vertical, to_y - y) : CS::CPL.encode(vertical, y - to_y);
+			shortest.consider(vertical, vertical_end, horizontal, horizontal_end);
+			if (to_y > y && to_y - y <= MAX_REPEATED_MOVES) {
+				vertical_end = repeat(repeat(vertical, '\r', 1), '\n', to_y - y);
+				shortest.consider(vertical, vertical_end, horizontal, horizontal_end);
+			}
+		}
+
+		vertical_end = CS::CUP.encode(vertical, to_y + 1, to_x + 1);
+		shortest.consider(vertical, vertical_end, horizontal, horizontal);
+
+		return shortest.write(out);
+	}
+
+	// Shortest bytes moving the cursor from column x of line y to column to_x of
+	// line to_y, see encode_cursor_movement()
+	inline std::string cursor_movement(size_t x, size_t y, size_t to_x, size_t to_y) {
+		char buffer[ECMA48::ControlSequence::MAX_LENGTH];
+		return std::string(buffer, encode_cursor_movement(buffer, x, y, to_x, to_y));
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                    UTF-8                                   //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	namespace utf8 {
+		const size_t MAX_LENGTH = 4;
+
+		const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+		// Writes the UTF-8 encoding of code point c at out, and returns the end of
+		// the written bytes
+		inline char* encode(char* out, uint32_t c) {
+			if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) c = REPLACEMENT_CHARACTER;
+			if (c < 0x80) {
+				*out++ = char(c);
+			} else if (c < 0x800) {
+				*out++ = char(0xC0 | (c >> 6));
+				*out++ = char(0x80 | (c & 0x3F));
+			} else if (c < 0x10000) {
+				*out++ = char(0xE0 | (c >> 12));
+				*out++ = char(0x80 | ((c >> 6) & 0x3F));
+				*out++ = char(0x80 | (c & 0x3F));
+			} else {
+				*out++ = char(0xF0 | (c >> 18));
+				*out++ = char(0x80 | ((c >> 12) & 0x3F));
+				*out++ = char(0x80 | ((c >> 6) & 0x3F));
+				*out++ = char(0x80 | (c & 0x3F));
+			}
+			return out;
+		}
+
+		// Decodes the code point at p, which must be before end, and advances p
+		// past it. Malformed sequences decode to REPLACEMENT_CHARACTER, one byte
+		// at a time.
+		inline uint32_t decode(const char*& p, const char* end) {
+			const unsigned char lead = *p++;
+			if (lead < 0x80) return lead;
+
+			size_t length;
+			uint32_t c;
+			if      (lead >= 0xC2 && lead <= 0xDF) length = 1, c = lead & 0x1F;
+			else if (lead >= 0xE0 && lead <= 0xEF) length = 2, c = lead & 0x0F;
+			else if (lead >= 0xF0 && lead <= 0xF4) length = 3, c = lead & 0x07;
+			else return REPLACEMENT_CHARACTER;
+
+			if (size_t(end - p) < length) return REPLACEMENT_CHARACTER;
+			for (size_t i=0; i<length; ++i) {
+				const unsigned char continuation = p[i];
+				if ((continuation & 0xC0) != 0x80) return REPLACEMENT_CHARACTER;
+				c = (c << 6) | (continuation & 0x3F);
+			}
+
+			// Overlong encodings, surrogates and code points past U+10FFFF
+			const uint32_t minimum = length == 1 ? 0x80 : length == 2 ? 0x800 : 0x10000;
+			if (c < minimum || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+				return REPLACEMENT_CHARACTER;
+
+			p += length;
+			return c;
+		}
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                Display width                               //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// Shared by all translation units
+	namespace detail {
+		// Code points U+0300 and above whose width is not 1, in increasing order:
+		// last is ORed with WIDE for ranges of width 2, of width 0 otherwise
+		struct WidthRange {
+			uint32_t first;
+			uint32_t last;
+		};
+
+		const uint32_t WIDE = 0x80000000;
+
+		constexpr WidthRange Z(uint32_t first, uint32_t last) { return WidthRange{ first, last }; }
+		constexpr WidthRange W(uint32_t first, uint32_t last) { return WidthRange{ first, last | WIDE }; }
+
+		// Generated from Unicode 14.0: width 0 for general categories Mn, Me and
+		// Cf except U+00AD, and for Hangul medial vowels and final consonants;
+		// width 2 for East Asian Wide and Fullwidth characters, and planes 2 and 3.
+		// Unassigned code points between two ranges of the same width are merged
+		// into them.
+		inline const WidthRange* width_ranges_end(const WidthRange*& begin) {
+			static constexpr WidthRange ranges[] = {
+			Z(0x00300, 0x0036F), Z(0x00483, 0x00489), Z(0x00591, 0x005BD), Z(0x005BF, 0x005BF),
+			Z(0x005C1, 0x005C2), Z(0x005C4, 0x005C5), Z(0x005C7, 0x005C7), Z(0x00600, 0x00605),
+			Z(0x00610, 0x0061A), Z(0x0061C, 0x0061C), Z(0x0064B, 0x0065F), Z(0x00670, 0x00670),
+			Z(0x006D6, 0x006DD), Z(0x006DF, 0x006E4), Z(0x006E7, 0x006E8), Z(0x006EA, 0x006ED),
+			Z(0x0070F, 0x0070F), Z(0x00711, 0x00711), Z(0x00730, 0x0074A), Z(0x007A6, 0x007B0),
+			Z(0x007EB, 0x007F3), Z(0x007FD, 0x007FD), Z(0x00816, 0x00819), Z(0x0081B, 0x00823),
+			Z(0x00825, 0x00827), Z(0x00829, 0x0082D), Z(0x00859, 0x0085B), Z(0x00890, 0x0089F),
+			Z(0x008CA, 0x00902), Z(0x0093A, 0x0093A), Z(0x0093C, 0x0093C), Z(0x00941, 0x00948),
+			Z(0x0094D, 0x0094D), Z(0x00951, 0x00957), Z(0x00962, 0x00963), Z(0x00981, 0x00981),
+			Z(0x009BC, 0x009BC), Z(0x009C1, 0x009C4), Z(0x009CD, 0x009CD), Z(0x009E2, 0x009E3),
+			Z(0x009FE, 0x00A02), Z(0x00A3C, 0x00A3C), Z(0x00A41, 0x00A51), Z(0x00A70, 0x00A71),
+			Z(0x00A75, 0x00A75), Z(0x00A81, 0x00A82), Z(0x00ABC, 0x00ABC), Z(0x00AC1, 0x00AC8),
+			Z(0x00ACD, 0x00ACD), Z(0x00AE2, 0x00AE3), Z(0x00AFA, 0x00B01), Z(0x00B3C, 0x00B3C),
+			Z(0x00B3F, 0x00B3F), Z(0x00B41, 0x00B44), Z(0x00B4D, 0x00B56), Z(0x00B62, 0x00B63),
+			Z(0x00B82, 0x00B82), Z(0x00BC0, 0x00BC0), Z(0x00BCD, 0x00BCD), Z(0x00C00, 0x00C00),
+			Z(0x00C04, 0x00C04), Z(0x00C3C, 0x00C3C), Z(0x00C3E, 0x00C40), Z(0x00C46, 0x00C56),
+			Z(0x00C62, 0x00C63), Z(0x00C81, 0x00C81), Z(0x00CBC, 0x00CBC), Z(0x00CBF, 0x00CBF),
+			Z(0x00CC6, 0x00CC6), Z(0x00CCC, 0x00CCD), Z(0x00CE2, 0x00CE3), Z(0x00D00, 0x00D01),
+			Z(0x00D3B, 0x00D3C), Z(0x00D41, 0x00D44), Z(0x00D4D, 0x00D4D), Z(0x00D62, 0x00D63),
+			Z(0x00D81, 0x00D81), Z(0x00DCA, 0x00DCA), Z(0x00DD2, 0x00DD6), Z(0x00E31, 0x00E31),
+			Z(0x00E34, 0x00E3A), Z(0x00E47, 0x00E4E), Z(0x00EB1, 0x00EB1), Z(0x00EB4, 0x00EBC),
+			Z(0x00EC8, 0x00ECD), Z(0x00F18, 0x00F19), Z(0x00F35, 0x00F35), Z(0x00F37, 0x00F37),
+			Z(0x00F39, 0x00F39), Z(0x00F71, 0x00F7E), Z(0x00F80, 0x00F84), Z(0x00F86, 0x00F87),
+			Z(0x00F8D, 0x00FBC), Z(0x00FC6, 0x00FC6), Z(0x0102D, 0x01030), Z(0x01032, 0x01037),
+			Z(0x01039, 0x0103A), Z(0x0103D, 0x0103E), Z(0x01058, 0x01059), Z(0x0105E, 0x01060),
+			Z(0x01071, 0x01074), Z(0x01082, 0x01082), Z(0x01085, 0x01086), Z(0x0108D, 0x0108D),
+			Z(0x0109D, 0x0109D), W(0x01100, 0x0115F), Z(0x01160, 0x011FF), Z(0x0135D, 0x0135F),
+			Z(0x01712, 0x01714), Z(0x01732, 0x01733), Z(0x01752, 0x01753), Z(0x01772, 0x01773),
+			Z(0x017B4, 0x017B5), Z(0x017B7, 0x017BD), Z(0x017C6, 0x017C6), Z(0x017C9, 0x017D3),
+			Z(0x017DD, 0x017DD), Z(0x0180B, 0x0180F), Z(0x01885, 0x01886), Z(0x018A9, 0x018A9),
+			Z(0x01920, 0x01922), Z(0x01927, 0x01928), Z(0x01932, 0x01932), Z(0x01939, 0x0193B),
+			Z(0x01A17, 0x01A18), Z(0x01A1B, 0x01A1B), Z(0x01A56, 0x01A56), Z(0x01A58, 0x01A60),
+			Z(0x01A62, 0x01A62), Z(0x01A65, 0x01A6C), Z(0x01A73, 0x01A7F), Z(0x01AB0, 0x01B03),
+			Z(0x01B34, 0x01B34), Z(0x01B36, 0x01B3A), Z(0x01B3C, 0x01B3C), Z(0x01B42, 0x01B42),
+			Z(0x01B6B, 0x01B73), Z(0x01B80, 0x01B81), Z(0x01BA2, 0x01BA5), Z(0x01BA8, 0x01BA9),
+			Z(0x01BAB, 0x01BAD), Z(0x01BE6, 0x01BE6), Z(0x01BE8, 0x01BE9), Z(0x01BED, 0x01BED),
+			Z(0x01BEF, 0x01BF1), Z(0x01C2C, 0x01C33), Z(0x01C36, 0x01C37), Z(0x01CD0, 0x01CD2),
+			Z(0x01CD4, 0x01CE0), Z(0x01CE2, 0x01CE8), Z(0x01CED, 0x01CED), Z(0x01CF4, 0x01CF4),
+			Z(0x01CF8, 0x01CF9), Z(0x01DC0, 0x01DFF), Z(0x0200B, 0x0200F), Z(0x0202A, 0x0202E),
+			Z(0x02060, 0x0206F), Z(0x020D0, 0x020F0), W(0x0231A, 0x0231B), W(0x02329, 0x0232A),
+			W(0x023E9, 0x023EC), W(0x023F0, 0x023F0), W(0x023F3, 0x023F3), W(0x025FD, 0x025FE),
+			W(0x02614, 0x02615), W(0x02648, 0x02653), W(0x0267F, 0x0267F), W(0x02693, 0x02693),
+			W(0x026A1, 0x026A1), W(0x026AA, 0x026AB), W(0x026BD, 0x026BE), W(0x026C4, 0x026C5),
+			W(0x026CE, 0x026CE), W(0x026D4, 0x026D4), W(0x026EA, 0x026EA), W(0x026F2, 0x026F3),
+			W(0x026F5, 0x026F5), W(0x026FA, 0x026FA), W(0x026FD, 0x026FD), W(0x02705, 0x02705),
+			W(0x0270A, 0x0270B), W(0x02728, 0x02728), W(0x0274C, 0x0274C), W(0x0274E, 0x0274E),
+			W(0x02753, 0x02755), W(0x02757, 0x02757), W(0x02795, 0x02797), W(0x027B0, 0x027B0),
+			W(0x027BF, 0x027BF), W(0x02B1B, 0x02B1C), W(0x02B50, 0x02B50), W(0x02B55, 0x02B55),
+			Z(0x02CEF, 0x02CF1), Z(0x02D7F, 0x02D7F), Z(0x02DE0, 0x02DFF), W(0x02E80, 0x03029),
+			Z(0x0302A, 0x0302D), W(0x0302E, 0x0303E), W(0x03041, 0x03096), Z(0x03099, 0x0309A),
+			W(0x0309B, 0x03247), W(0x03250, 0x04DBF), W(0x04E00, 0x0A4C6), Z(0x0A66F, 0x0A672),
+			Z(0x0A674, 0x0A67D), Z(0x0A69E, 0x0A69F), Z(0x0A6F0, 0x0A6F1), Z(0x0A802, 0x0A802),
+			Z(0x0A806, 0x0A806), Z(0x0A80B, 0x0A80B), Z(0x0A825, 0x0A826), Z(0x0A82C, 0x0A82C),
+			Z(0x0A8C4, 0x0A8C5), Z(0x0A8E0, 0x0A8F1), Z(0x0A8FF, 0x0A8FF), Z(0x0A926, 0x0A92D),
+			Z(0x0A947, 0x0A951), W(0x0A960, 0x0A97C), Z(0x0A980, 0x0A982), Z(0x0A9B3, 0x0A9B3),
+			Z(0x0A9B6, 0x0A9B9), Z(0x0A9BC, 0x0A9BD), Z(0x0A9E5, 0x0A9E5), Z(0x0AA29, 0x0AA2E),
+			Z(0x0AA31, 0x0AA32), Z(0x0AA35, 0x0AA36), Z(0x0AA43, 0x0AA43), Z(0x0AA4C, 0x0AA4C),
+			Z(0x0AA7C, 0x0AA7C), Z(0x0AAB0, 0x0AAB0), Z(0x0AAB2, 0x0AAB4), Z(0x0AAB7, 0x0AAB8),
+			Z(0x0AABE, 0x0AABF), Z(0x0AAC1, 0x0AAC1), Z(0x0AAEC, 0x0AAED), Z(0x0AAF6, 0x0AAF6),
+			Z(0x0ABE5, 0x0ABE5), Z(0x0ABE8, 0x0ABE8), Z(0x0ABED, 0x0ABED), W(0x0AC00, 0x0D7A3),
+			Z(0x0D7B0, 0x0D7FB), W(0x0F900, 0x0FAD9), Z(0x0FB1E, 0x0FB1E), Z(0x0FE00, 0x0FE0F),
+			W(0x0FE10, 0x0FE19), Z(0x0FE20, 0x0FE2F), W(0x0FE30, 0x0FE6B), Z(0x0FEFF, 0x0FEFF),
+			W(0x0FF01, 0x0FF60), W(0x0FFE0, 0x0FFE6), Z(0x0FFF9, 0x0FFFB), Z(0x101FD, 0x101FD),
+			Z(0x102E0, 0x102E0), Z(0x10376, 0x1037A), Z(0x10A01, 0x10A0F), Z(0x10A38, 0x10A3F),
+			Z(0x10AE5, 0x10AE6), Z(0x10D24, 0x10D27), Z(0x10EAB, 0x10EAC), Z(0x10F46, 0x10F50),
+			Z(0x10F82, 0x10F85), Z(0x11001, 0x11001), Z(0x11038, 0x11046), Z(0x11070, 0x11070),
+			Z(0x11073, 0x11074), Z(0x1107F, 0x11081), Z(0x110B3, 0x110B6), Z(0x110B9, 0x110BA),
+			Z(0x110BD, 0x110BD), Z(0x110C2, 0x110CD), Z(0x11100, 0x11102), Z(0x11127, 0x1112B),
+			Z(0x1112D, 0x11134), Z(0x11173, 0x11173), Z(0x11180, 0x11181), Z(0x111B6, 0x111BE),
+			Z(0x111C9, 0x111CC), Z(0x111CF, 0x111CF), Z(0x1122F, 0x11231), Z(0x11234, 0x11234),
+			Z(0x11236, 0x11237), Z(0x1123E, 0x1123E), Z(0x112DF, 0x112DF), Z(0x112E3, 0x112EA),
+			Z(0x11300, 0x11301), Z(0x1133B, 0x1133C), Z(0x11340, 0x11340), Z(0x11366, 0x11374),
+			Z(0x11438, 0x1143F), Z(0x11442, 0x11444), Z(0x11446, 0x11446), Z(0x1145E, 0x1145E),
+			Z(0x114B3, 0x114B8), Z(0x114BA, 0x114BA), Z(0x114BF, 0x114C0), Z(0x114C2, 0x114C3),
+			Z(0x115B2, 0x115B5), Z(0x115BC, 0x115BD), Z(0x115BF, 0x115C0), Z(0x115DC, 0x115DD),
+			Z(0x11633, 0x1163A), Z(0x1163D, 0x1163D), Z(0x1163F, 0x11640), Z(0x116AB, 0x116AB),
+			Z(0x116AD, 0x116AD), Z(0x116B0, 0x116B5), Z(0x116B7, 0x116B7), Z(0x1171D, 0x1171F),
+			Z(0x11722, 0x11725), Z(0x11727, 0x1172B), Z(0x1182F, 0x11837), Z(0x11839, 0x1183A),
+			Z(0x1193B, 0x1193C), Z(0x1193E, 0x1193E), Z(0x11943, 0x11943), Z(0x119D4, 0x119DB),
+			Z(0x119E0, 0x119E0), Z(0x11A01, 0x11A0A), Z(0x11A33, 0x11A38), Z(0x11A3B, 0x11A3E),
+			Z(0x11A47, 0x11A47), Z(0x11A51, 0x11A56), Z(0x11A59, 0x11A5B), Z(0x11A8A, 0x11A96),
+			Z(0x11A98, 0x11A99), Z(0x11C30, 0x11C3D), Z(0x11C3F, 0x11C3F), Z(0x11C92, 0x11CA7),
+			Z(0x11CAA, 0x11CB0), Z(0x11CB2, 0x11CB3), Z(0x11CB5, 0x11CB6), Z(0x11D31, 0x11D45),
+			Z(0x11D47, 0x11D47), Z(0x11D90, 0x11D91), Z(0x11D95, 0x11D95), Z(0x11D97, 0x11D97),
+			Z(0x11EF3, 0x11EF4), Z(0x13430, 0x13438), Z(0x16AF0, 0x16AF4), Z(0x16B30, 0x16B36),
+			Z(0x16F4F, 0x16F4F), Z(0x16F8F, 0x16F92), W(0x16FE0, 0x16FE3), Z(0x16FE4, 0x16FE4),
+			W(0x16FF0, 0x1B2FB), Z(0x1BC9D, 0x1BC9E), Z(0x1BCA0, 0x1CF46), Z(0x1D167, 0x1D169),
+			Z(0x1D173, 0x1D182), Z(0x1D185, 0x1D18B), Z(0x1D1AA, 0x1D1AD), Z(0x1D242, 0x1D244),
+			Z(0x1DA00, 0x1DA36), Z(0x1DA3B, 0x1DA6C), Z(0x1DA75, 0x1DA75), Z(0x1DA84, 0x1DA84),
+			Z(0x1DA9B, 0x1DAAF), Z(0x1E000, 0x1E02A), Z(0x1E130, 0x1E136), Z(0x1E2AE, 0x1E2AE),
+			Z(0x1E2EC, 0x1E2EF), Z(0x1E8D0, 0x1E8D6), Z(0x1E944, 0x1E94A), W(0x1F004, 0x1F004),
+			W(0x1F0CF, 0x1F0CF), W(0x1F18E, 0x1F18E), W(0x1F191, 0x1F19A), W(0x1F200, 0x1F320),
+			W(0x1F32D, 0x1F335), W(0x1F337, 0x1F37C), W(0x1F37E, 0x1F393), W(0x1F3A0, 0x1F3CA),
+			W(0x1F3CF, 0x1F3D3), W(0x1F3E0, 0x1F3F0), W(0x1F3F4, 0x1F3F4), W(0x1F3F8, 0x1F43E),
+			W(0x1F440, 0x1F440), W(0x1F442, 0x1F4FC), W(0x1F4FF, 0x1F53D), W(0x1F54B, 0x1F54E),
+			W(0x1F550, 0x1F567), W(0x1F57A, 0x1F57A), W(0x1F595, 0x1F596), W(0x1F5A4, 0x1F5A4),
+			W(0x1F5FB, 0x1F64F), W(0x1F680, 0x1F6C5), W(0x1F6CC, 0x1F6CC), W(0x1F6D0, 0x1F6D2),
+			W(0x1F6D5, 0x1F6DF), W(0x1F6EB, 0x1F6EC), W(0x1F6F4, 0x1F6FC), W(0x1F7E0, 0x1F7F0),
+			W(0x1F90C, 0x1F93A), W(0x1F93C, 0x1F945), W(0x1F947, 0x1F9FF), W(0x1FA70, 0x1FAF6),
+			W(0x20000, 0x3FFFD), Z(0xE0001, 0xE01EF),
+			};
+			begin = ranges;
+			return ranges + sizeof(ranges) / sizeof(ranges[0]);
+		}
+	}
+
+	// ––––––––––––––––
+	// Helper functions
+
+	namespace {
+#ifdef __SSE2__
+		// Whether the 16 bytes at p are printable ASCII, 02/00 to 07/14. In signed
+		// comparisons, bytes from 08/00 are below 02/00.
+		inline bool sse2_is_printable_ascii(const char* p) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i other = _mm_or_si128(_mm_cmplt_epi8(bytes, _mm_set1_epi8(0x20)),
+			                                   _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7F)));
+			return _mm_movemask_epi8(other) == 0;
+		}
+#endif
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// Number of terminal columns taken by code point c: 0 for controls,
+	// combining marks and other zero-width characters, 2 for wide East Asian
+	// characters and emoji, 1 otherwise
+	inline size_t code_point_width(uint32_t c) {
+		if (c < 0x300) return c < 0x20 || (c >= 0x7F && c < 0xA0) ? 0 : 1;
+
+		const detail::WidthRange* begin;
+		const detail::WidthRange* const end = detail::width_ranges_end(begin);
+		const detail::WidthRange* range = std::upper_bound(begin, end, c,
+			[](uint32_t value, const detail::WidthRange& range) { return value < range.first; });
+		if (range == begin) return 1;
+		--range;
+		if (c > (range->last & ~detail::WIDE)) return 1;
+		return (range->last & detail::WIDE) != 0 ? 2 : 0;
+	}
+
+	// Number of columns taken by UTF-8 text without control functions. Runs of
+	// printable ASCII are counted 16 bytes at a time with SSE2.
+	inline size_t text_width(const char* p, const char* end) {
+		size_t width = 0;
+		while (p != end) {
+#ifdef __SSE2__
+			while (end - p >= 16 && sse2_is_printable_ascii(p)) {
+				width += 16;
+				p += 16;
+			}
+			if (p == end) break;
+#endif
+			const unsigned char c = *p;
+			if (c >= 0x20 && c < 0x7F) {
+				++width;
+				++p;
+			} else {
+				width += code_point_width(utf8::decode(p, end));
+			}
+		}
+		return width;
+	}
+
+	// Number of columns taken by UTF-8 text on a terminal: control functions
+	// are skipped as by strip(), and C0 controls take no column. Malformed UTF-8
+	// counts one column per byte, like the replacement characters terminals
+	// show.
+	inline size_t display_width(const char* data, size_t size) {
+		size_t width = 0;
+		Stripper stripper;
+		stripper.feed(data, size, [&width](const char* text, size_t length) { width += text_width(text, text + length); });
+		stripper.finish([&width](const char* text, size_t length) { width += text_width(text, text + length); });
+		return width;
+	}
+
+	inline size_t display_width(const std::string& s) {
+		return display_width(s.data(), s.size());
+	}
+
+	inline size_t display_width(const char* s) {
+		return display_width(s, std::strlen(s));
+	}
+
+	// ·······
+	// Padding
+
+	// Object written padded with the stream's fill character to a number of
+	// display columns, unlike with std::setw, which counts bytes. The object is
+	// first written to a string with the stream's format and color settings.
+	//
+	//     std::cout << dye::align_right(dye::red(count), 6) << " errors\n";
+	template <typename ObjectType>
+	class Aligned {
+		public:
+			Aligned(const ObjectType& object, size_t width, bool right)
+				: object_(object)
+				, width_(width)
+				, right_(right)
+				{}
+
+			const ObjectType& object() const { return object_; }
+			size_t width() const { return width_; }
+			bool is_right() const { return right_; }
+
+		private:
+			const ObjectType& object_;
+			size_t width_;
+			bool right_;
+	};
+
+	template <typename ObjectType>
+	inline Aligned<ObjectType> align_left(const ObjectType& object, size_t width) {
+		return Aligned<ObjectType>(object, width, false);
+	}
+
+	template <typename ObjectType>
+	inline Aligned<ObjectType> align_right(const ObjectType& object, size_t width) {
+		return Aligned<ObjectType>(object, width, true);
+	}
+
+	template <typename ObjectType>
+	inline std::ostream& operator<<(std::ostream& stream, const Aligned<ObjectType>& aligned) {
+		std::ostringstream text;
+		text.copyfmt(stream);
+		text.width(0);
+		set_color_policy(text, is_colored(stream) ? ALWAYS_COLOR : NEVER_COLOR);
+		set_color_depth(text, is_24bit(stream) ? TRUECOLOR_DEPTH : XTERM256_DEPTH);
+		text << aligned.object();
+
+		const std::string s = text.str();
+		const size_t width = display_width(s);
+		const std::string padding(aligned.width() > width ? aligned.width() - width : 0, stream.fill());
+		stream.width(0);
+		if (aligned.is_right()) stream << padding << s;
+		else                    stream << s << padding;
+		return stream;
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                    HTML                                    //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// How HtmlConverter writes renditions
+	enum HtmlStyling {
+		INLINE_STYLES = 0, // Style attributes, self-contained (default)
+		CSS_CLASSES   = 1  // Classes of html_stylesheet(), and styles for 24-bit colors
+	};
+
+	// ––––––––––––––––
+	// Helper functions
+
+	namespace {
+		// xterm's default palette for the standard colors
+		const uint32_t HTML_STANDARD_COLORS[xterm256::STANDARD_RANGE] = {
+			0x000000, 0xCD0000, 0x00CD00, 0xCDCD00, 0x0000EE, 0xCD00CD, 0x00CDCD, 0xE5E5E5,
+			0x7F7F7F, 0xFF0000, 0x00FF00, 0xFFFF00, 0x5C5CFF, 0xFF00FF, 0x00FFFF, 0xFFFFFF
+		};
+
+		// Class names of the attributes, in the order of Rendition::Attribute
+		const char* const HTML_ATTRIBUTE_CLASSES[] = {
+			"dye-bold", "dye-faint", "dye-italic", "dye-underlined", "dye-slow-blinking",
+			"dye-rapid-blinking", "dye-negative", "dye-concealed", "dye-crossed", "dye-fraktur",
+			"dye-doubly-underlined", "dye-framed", "dye-encircled", "dye-overlined"
+		};
+
+		const size_t HTML_ATTRIBUTE_COUNT = sizeof(HTML_ATTRIBUTE_CLASSES) / sizeof(HTML_ATTRIBUTE_CLASSES[0]);
+
+		// Longest opening tag html_open_span() writes
+		const size_t MAX_HTML_SPAN_LENGTH = 512;
+
+		// 0xRRGGBB of xterm256 color i
+		inline uint32_t html_xterm256_color(size_t i) {
+			if (i <= xterm256::STANDARD_END) return HTML_STANDARD_COLORS[i];
+			if (i >= xterm256::GREY_START) {
+				const uint32_t v = uint32_t(xterm256::FIRST_GREY_CHANNEL + (i - xterm256::GREY_START) * xterm256::GREY_CHANNEL_STEP);
+				return v << 16 | v << 8 | v;
+			}
+			const size_t levels = i - xterm256::EXTENDED_START;
+			return uint32_t(xterm256::extended_value_from_level(levels / 36)     << 16
+			              | xterm256::extended_value_from_level(levels / 6 % 6) << 8
+			              | xterm256::extended_value_from_level(levels % 6));
+		}
+
+		inline uint32_t html_color(const Color& color) {
+			if (color.kind() == Color::RGB24) return uint32_t(color.r() << 16 | color.g() << 8 | color.b());
+			return html_xterm256_color(color.index());
+		}
+
+		inline char* html_append(char* out, const char* s) {
+			while (*s != '\0') *out++ = *s++;
+			return out;
+		}
+
+		// String literals, copied with their length known at compile time
+		template <size_t N>
+		inline char* html_append_literal(char* out, const char (&s)[N]) {
+			std::memcpy(out, s, N - 1);
+			return out + N - 1;
+		}
+
+		// Writes #RRGGBB
+		inline char* html_append_color(char* out, uint32_t rgb) {
+			static const char HEX[] = "0123456789abcdef";
+			*out++ = '#';
+			for (int shift=20; shift>=0; shift-=4) *out++ = HEX[rgb >> shift & 0xF];
+			return out;
+		}
+
+		inline char* html_append_index(char* out, size_t i) {
+			char digits[3];
+			size_t n = 0;
+			do {
+				digits[n++] = char('0' + i % 10);
+				i /= 10;
+			} while (i != 0);
+			while (n != 0) *out++ = digits[--n];
+			return out;
+		}
+
+		// Attributes drawing lines, combined in one text-decoration declaration
+		const unsigned HTML_LINE_ATTRIBUTES = Rendition::UNDERLINED | Rendition::DOUBLY_UNDERLINED
+		                                    | Rendition::CROSSED    | Rendition::OVERLINED;
+
+		inline char* html_append_text_decoration(char* out, unsigned attributes) {
+			out = html_append_literal(out, "text-decoration:");
+			if (attributes & (Rendition::UNDERLINED | Rendition::DOUBLY_UNDERLINED)) out = html_append_literal(out, "underline ");
+			if (attributes & Rendition::CROSSED)   out = html_append_literal(out, "line-through ");
+			if (attributes & Rendition::OVERLINED) out = html_append_literal(out, "overline ");
+			if (attributes & Rendition::DOUBLY_UNDERLINED) out = html_append_literal(out, "double ");
+			out[-1] = ';';
+			return out;
+		}
+
+		// Declarations styling the attributes in a style attribute, as
+		// html_stylesheet() styles their classes
+		inline char* html_append_attribute_styles(char* out, unsigned attributes) {
+			if (attributes & Rendition::BOLD)   out = html_append_literal(out, "font-weight:bold;");
+			if (attributes & Rendition::FAINT)  out = html_append_literal(out, "opacity:0.5;");
+			if (attributes & Rendition::ITALIC) out = html_append_literal(out, "font-style:italic;");
+
+			if (attributes & HTML_LINE_ATTRIBUTES) out = html_append_text_decoration(out, attributes);
+			if (attributes & (Rendition::FRAMED | Rendition::ENCIRCLED)) out = html_append_literal(out, "border:1px solid;");
+			if (attributes & Rendition::ENCIRCLED) out = html_append_literal(out, "border-radius:0.5em;");
+			if (attributes & Rendition::CONCEALED) out = html_append_literal(out, "color:transparent;");
+			return out;
+		}
+
+		// Opening tag of a span of rendition r, with colors swapped if it is
+		// NEGATIVE. Default colors of negative renditions are the page's,
+		// CanvasText and Canvas.
+		inline char* html_open_span(char* out, const Rendition& r, HtmlStyling styling) {
+			const bool negative = r.has(Rendition::NEGATIVE);
+			const Color& fg = negative ? r.bg : r.fg;
+			const Color& bg = negative ? r.fg : r.bg;
+
+			out = html_append_literal(out, "<span");
+			if (styling == CSS_CLASSES) {
+				out = html_append_literal(out, " class=\"");
+				char* const classes = out;
+				for (size_t i=0; i<HTML_ATTRIBUTE_COUNT; ++i) {
+					if ((r.attributes >> i & 1) == 0) continue;
+					if (out != classes) *out++ = ' ';
+					out = html_append(out, HTML_ATTRIBUTE_CLASSES[i]);
+				}
+				if (!fg.is_default() && fg.kind() != Color::RGB24) {
+					if (out != classes) *out++ = ' ';
+					out = html_append_index(html_append_literal(out, "dye-fg-"), fg.index());
+				}
+				if (!bg.is_default() && bg.kind() != Color::RGB24) {
+					if (out != classes) *out++ = ' ';
+					out = html_append_index(html_append_literal(out, "dye-bg-"), bg.index());
+				}
+				*out++ = '"';
+				if (out == classes + 1) out -= sizeof(" class=\"");
+
+				// Classes of several lines would override each other's text-decoration
+				const unsigned lines = r.attributes & HTML_LINE_ATTRIBUTES;
+				const bool has_lines = (lines & (lines - 1)) != 0;
+				if (fg.kind() != Color::RGB24 && bg.kind() != Color::RGB24 && !has_lines)
+					return html_append_literal(out, ">");
+				out = html_append_literal(out, " style=\"");
+				if (fg.kind() == Color::RGB24 && !r.has(Rendition::CONCEALED))
+					out = html_append_literal(html_append_color(html_append_literal(out, "color:"), html_color(fg)), ";");
+				if (bg.kind() == Color::RGB24)
+					out = html_append_literal(html_append_color(html_append_literal(out, "background-color:"), html_color(bg)), ";");
+				if (has_lines) out = html_append_text_decoration(out, r.attributes);
+				return html_append_literal(out, "\">");
+			}
+
+			out = html_append_literal(out, " style=\"");
+			if (!fg.is_default())
+				out = html_append_literal(html_append_color(html_append_literal(out, "color:"), html_color(fg)), ";");
+			else if (negative)
+				out = html_append_literal(out, "color:Canvas;");
+			if (!bg.is_default())
+				out = html_append_literal(html_append_color(html_append_literal(out, "background-color:"), html_color(bg)), ";");
+			else if (negative)
+				out = html_append_literal(out, "background-color:CanvasText;");
+			out = html_append_attribute_styles(out, r.attributes);
+			return html_append_literal(out, "\">");
+		}
+
+		inline bool is_html_special(char c) {
+			return c == '&' || c == '<' || c == '>';
+		}
+
+#ifdef __SSE2__
+		// Whether one of the 16 bytes at p is '&', '<' or '>'
+		inline bool sse2_has_html_special(const char* p) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			const __m128i found = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('&')),
+			                      _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('<')),
+			                                   _mm_cmpeq_epi8(bytes, _mm_set1_epi8('>'))));
+			return _mm_movemask_epi8(found) != 0;
+		}
+#endif
+
+		// First '&', '<' or '>' of [p, end), or end
+		inline const char* find_html_special(const char* p, const char* end) {
+#ifdef __SSE2__
+			while (end - p >= 16 && !sse2_has_html_special(p)) p += 16;
+#endif
+			while (p != end && !is_html_special(*p)) ++p;
+			return p;
+		}
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// HtmlConverter turns ECMA-48 encoded bytes, given in chunks of any size,
+	// into an HTML fragment to be placed in a <pre> element. Text is escaped,
+	// and the renditions selected by SGR are written as <span> elements: a span
+	// is only opened when text follows a change of rendition, so that runs of
+	// text of one rendition share it however many sequences select it. Other
+	// control functions, and C0 controls other than LF and HT, are dropped.
+	//
+	//     dye::HtmlConverter converter;
+	//     while (size_t n = read(chunk))
+	//         converter.feed(chunk, n, [](const char* html, size_t size) { ... });
+	//     converter.finish([](const char* html, size_t size) { ... });
+	//
+	// HTML is given to write(const char* data, size_t size) in pieces, through
+	// a buffer of BUFFER_SIZE bytes: memory use does not depend on the input.
+	// Colors are written in xterm's default palette. With CSS_CLASSES, spans
+	// have classes styled by html_stylesheet(), and style attributes only for
+	// 24-bit colors and combined lines, e.g. underlined and crossed. Blinking
+	// and Fraktur only have classes.
+	class HtmlConverter {
+		public:
+			static const size_t BUFFER_SIZE = 4096;
+
+			explicit HtmlConverter(HtmlStyling styling = INLINE_STYLES)
+				: styling_(styling)
+				, size_(0)
+				{}
+
+			template <typename F>
+			void feed(const char* data, size_t size, F write) {
+				tokenizer_.feed(data, size, [this, &write](const ECMA48::Token& token) {
+					on_token(token, write);
+				});
+			}
+
+			// Ends the input, closing the last span, and writes the buffered HTML
+			template <typename F>
+			void finish(F write) {
+				tokenizer_.finish([](const ECMA48::Token&) {});
+				if (!span_.is_default()) put("</span>", sizeof("</span>") - 1, write);
+				span_ = rendition_ = Rendition();
+				flush(write);
+			}
+
+		private:
+			template <typename F>
+			void on_token(const ECMA48::Token& token, F& write) {
+				switch (token.kind) {
+					case ECMA48::Token::TEXT:
+						text(token.bytes.data(), token.bytes.data() + token.bytes.size(), write);
+						break;
+					case ECMA48::Token::C0_CONTROL:
+						if (token.function == '\t') text(token.bytes.data(), token.bytes.data() + 1, write);
+						else if (token.function == '\n') put("\n", 1, write);
+						break;
+					case ECMA48::Token::CONTROL_SEQUENCE:
+						rendition_.apply(token);
+						break;
+					default:
+						break;
+				}
+			}
+
+			// Escapes [p, end), in a span of the current rendition
+			template <typename F>
+			void text(const char* p, const char* end, F& write) {
+				if (span_ != rendition_) {
+					char tag[sizeof("</span>") + MAX_HTML_SPAN_LENGTH];
+					char* out = tag;
+					if (!span_.is_default()) out = html_append_literal(out, "</span>");
+					if (!rendition_.is_default()) out = html_open_span(out, rendition_, styling_);
+					put(tag, out - tag, write);
+					span_ = rendition_;
+				}
+
+				while (p != end) {
+					const char* const special = find_html_special(p, end);
+					put(p, special - p, write);
+					if (special == end) break;
+					switch (*special) {
+						case '&': put("&amp;", 5, write); break;
+						case '<': put("&lt;",  4, write); break;
+						default:  put("&gt;",  4, write); break;
+					}
+					p = special + 1;
+				}
+			}
+
+			// Writes through the buffer, except for runs of half of it or more which
+			// do not fit in it
+			template <typename F>
+			void put(const char* data, size_t size, F& write) {
+				if (size <= BUFFER_SIZE - size_) {
+					std::memcpy(buffer_ + size_, data, size);
+					size_ += size;
+					return;
+				}
+				flush(write);
+				if (size < BUFFER_SIZE / 2) {
+					std::memcpy(buffer_, data, size);
+					size_ = size;
+				} else {
+					write(data, size);
+				}
+			}
+
+			template <typename F>
+			void flush(F& write) {
+				if (size_ != 0) write(static_cast<const char*>(buffer_), size_);
+				size_ = 0;
+			}
+
+			ECMA48::Tokenizer tokenizer_;
+			HtmlStyling styling_;
+			Rendition rendition_; // Selected by the input
+			Rendition span_;      // Of the open span, default if none is
+			char buffer_[BUFFER_SIZE];
+			size_t size_;
+	};
+
+	// Appends the HTML of [data, data+size) to out, see HtmlConverter
+	inline void html(std::string& out, const char* data, size_t size, HtmlStyling styling = INLINE_STYLES) {
+		HtmlConverter converter(styling);
+		converter.feed(data, size, [&out](const char* html, size_t length) { out.append(html, length); });
+		converter.finish([&out](const char* html, size_t length) { out.append(html, length); });
+	}
+
+	inline std::string html(const char* data, size_t size, HtmlStyling styling = INLINE_STYLES) {
+		std::string out;
+		out.reserve(size + size / 4);
+		html(out, data, size, styling);
+		return out;
+	}
+
+	inline std::string html(const std::string& s, HtmlStyling styling = INLINE_STYLES) {
+		return html(s.data(), s.size(), styling);
+	}
+
+	inline std::string html(const char* s, HtmlStyling styling = INLINE_STYLES) {
+		return html(s, std::strlen(s), styling);
+	}
+
+	// Style sheet of the classes written with CSS_CLASSES: attributes, then the
+	// 256 foreground and background colors, which take precedence over the
+	// default colors of dye-negative
+	inline std::string html_stylesheet() {
+		std::string css =
+			".dye-bold{font-weight:bold}\n"
+			".dye-faint{opacity:0.5}\n"
+			".dye-italic,.dye-fraktur{font-style:italic}\n"
+			".dye-underlined{text-decoration:underline}\n"
+			".dye-doubly-underlined{text-decoration:underline double}\n"
+			".dye-crossed{text-decoration:line-through}\n"
+			".dye-overlined{text-decoration:overline}\n"
+			".dye-slow-blinking{animation:dye-blink 1s step-end infinite}\n"
+			".dye-rapid-blinking{animation:dye-blink 0.5s step-end infinite}\n"
+			"@keyframes dye-blink{50%{opacity:0}}\n"
+			".dye-framed,.dye-encircled{border:1px solid}\n"
+			".dye-encircled{border-radius:0.5em}\n"
+			".dye-negative{color:Canvas;background-color:CanvasText}\n";
+
+		char rule[sizeof(".dye-bg-255{background-color:#rrggbb}\n")];
+		for (size_t i=0; i<=xterm256::GREY_END; ++i) {
+			const uint32_t rgb = html_xterm256_color(i);
+			char* out = html_append_index(html_append_literal(rule, ".dye-fg-"), i);
+			out = html_append_literal(html_append_color(html_append_literal(out, "{color:"), rgb), "}\n");
+			css.append(rule, out - rule);
+			out = html_append_index(html_append_literal(rule, ".dye-bg-"), i);
+			out = html_append_literal(html_append_color(html_append_literal(out, "{background-color:"), rgb), "}\n");
+			css.append(rule, out - rule);
+		}
+		css += ".dye-concealed{color:transparent}\n";
+		return css;
+	}
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                   Screens                                  //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// A Screen holds two grids of cells: the front buffer, what the terminal is
+	// known to display, and the back buffer, which the program draws into.
+	// render() compares them and only writes the runs of cells that changed,
+	// positioned with the shortest cursor movements, with blanks erased by
+	// EL/ECH, identical cells repeated by REP if the stream's repeat policy
+	// allows it, and one SGR transition per change of rendition. The back buffer
+	// then becomes the front buffer.
+	//
+	// Every cell is assumed to be one column wide. Erased cells are assumed to
+	// take the current background color, as on xterm-compatible terminals.
+
+	struct Cell {
+		uint32_t code_point;
+		Rendition rendition;
+
+		constexpr Cell()
+			: code_point(' '), rendition()
+			{}
+
+		constexpr Cell(uint32_t code_point, const Rendition& rendition = Rendition())
+			: code_point(code_point), rendition(rendition)
+			{}
+
+		// Whether EL and ECH can draw the cell: blanks only show their background
+		bool is_blank() const { return code_point == ' ' && rendition.attributes == 0; }
+	};
+
+	inline bool operator==(const Cell& a, const Cell& b) {
+		return a.code_point == b.code_point && a.rendition == b.rendition;
+	}
+
+	inline bool operator!=(const Cell& a, const Cell& b) { return !(a == b); }
+
+	class Screen {
+		public:
+			Screen(size_t width, size_t height)
+				: width_(width)
+				, height_(height)
+				, back_(width * height)
+				, front_(width * height)
+				, front_is_valid_(false)
+				, cursor_is_known_(false)
+				, cursor_x_(0)
+				, cursor_y_(0)
+				, rendition_is_known_(false)
+				, rendition_()
+				, repeats_(false)
+				{}
+
+			size_t width() const { return width_; }
+			size_t height() const { return height_; }
+
+			// Back buffer
+
+			Cell& operator()(size_t x, size_t y) {
+				assert(x < width_ && y < height_);
+				return back_[y * width_ + x];
+			}
+
+			const Cell& operator()(size_t x, size_t y) const {
+				assert(x < width_ && y < height_);
+				return back_[y * width_ + x];
+			}
+
+			void clear(const Rendition& rendition = Rendition()) {
+				std::fill(back_.begin(), back_.end(), Cell(' ', rendition));
+			}
+
+			// Writes UTF-8 text into the back buffer from column x of row y, clipped
+			// at the end of the row, and returns the column following it. Control
+			// characters are replaced by U+FFFD.
+			size_t print(size_t x, size_t y, const std::string& text, const Rendition& rendition = Rendition()) {
+				assert(y < height_);
+				const char* p = text.data();
+				const char* const end = p + text.size();
+				for (; p != end && x < width_; ++x) {
+					uint32_t c = utf8::decode(p, end);
+					if (c < 0x20 || (c >= 0x7F && c < 0xA0)) c = utf8::REPLACEMENT_CHARACTER;
+					back_[y * width_ + x] = Cell(c, rendition);
+				}
+				return x;
+			}
+
+			size_t print(size_t x, size_t y, const std::string& text, const Style& style) {
+				return print(x, y, text, style.applied_to(Rendition()));
+			}
+
+			// Makes the next render() clear the terminal and draw every cell
+			void invalidate() {
+				front_is_valid_ = false;
+			}
+
+			// Writes to stream what turns the front buffer into the back buffer, which
+			// becomes the front buffer. The terminal is left in the default rendition.
+			void render(std::ostream& stream) {
+				frame_.clear();
+
+				if (!front_is_valid_) {
+					append(ECMA48::reset);
+					append_sequence(ECMA48::ControlSequence::ED, 2);
+					std::fill(front_.begin(), front_.end(), Cell());
+					front_is_valid_ = true;
+					rendition_is_known_ = true;
+					rendition_ = Rendition();
+				} else {
+					// Anything may have been written to the terminal since the last frame
+					rendition_is_known_ = false;
+				}
+				cursor_is_known_ = false;
+				repeats_ = is_repeated(stream);
+
+				for (size_t y=0; y<height_; ++y) {
+					size_t x = 0;
+					while (x < width_) {
+						if (back_[y * width_ + x] == front_[y * width_ + x]) {
+							++x;
+							continue;
+						}
+						x = render_run(x, run_end(x, y), y);
+					}
+				}
+
+				if (rendition_is_known_) set_rendition(Rendition());
+				stream.write(frame_.data(), frame_.size());
+			}
+
+		private:
+			// Unchanged cells between changed ones are rewritten rather than skipped
+			// when there are at most MAX_GAP of them: repositioning costs more.
+			static const size_t MAX_GAP = 4;
+
+			// Blanks are erased rather than written when there are more than these
+			static const size_t MIN_EL_BLANKS  = 3;  // CSI K
+			static const size_t MIN_ECH_BLANKS = 10; // CSI n X, then a cursor move
+
+			// End of the run of changed cells starting at x
+			size_t run_end(size_t x, size_t y) const {
+				const Cell* back  = &back_[y * width_];
+				const Cell* front = &front_[y * width_];
+				size_t last_changed = x;
+				for (size_t i=x+1; i<width_ && i-last_changed <= MAX_GAP; ++i)
+					if (back[i] != front[i]) last_changed = i;
+				return last_changed + 1;
+			}
+
+			// Draws cells [x, end) of row y and returns the column where scanning for
+			// changes resumes
+			size_t render_run(size_t x, size_t end, size_t y) {
+				const Cell* back = &back_[y * width_];
+				Cell* front = &front_[y * width_];
+
+				for (size_t i=x; i<end; ) {
+					const Cell& cell = back[i];
+
+					if (cell.is_blank()) {
+						size_t blanks_end = i + 1;
+						while (blanks_end < width_ && back[blanks_end] == cell) ++blanks_end;
+						const size_t blanks = blanks_end - i;
+
+						if (blanks_end == width_ && blanks > MIN_EL_BLANKS) {
+							move_to(i, y);
+							set_rendition(cell.rendition);
+							append_sequence(ECMA48::ControlSequence::EL, 0);
+							std::copy(back + i, back + width_, front + i);
+							return width_;
+						}
+
+						if (blanks > MIN_ECH_BLANKS) {
+							move_to(i, y);
+							set_rendition(cell.rendition);
+							append_sequence(ECMA48::ControlSequence::ECH, blanks);
+							std::copy(back + i, back + blanks_end, front + i);
+							i = blanks_end;
+							continue;
+						}
+					}
+
+					size_t repeated_end = i + 1;
+					if (repeats_)
+						while (repeated_end < end && back[repeated_end] == cell) ++repeated_end;
+					const size_t count = repeated_end - i;
+
+					move_to(i, y);
+					set_rendition(cell.rendition);
+					char buffer[utf8::MAX_LENGTH];
+					const size_t length = utf8::encode(buffer, cell.code_point) - buffer;
+					if (repetition_is_shorter(length, count)) {
+						frame_.append(buffer, length);
+						append_sequence(ECMA48::ControlSequence::REP, count - 1);
+					} else {
+						for (size_t j=0; j<count; ++j) frame_.append(buffer, length);
+					}
+					std::fill(front + i, front + repeated_end, cell);
+					i = repeated_end;
+
+					// The cursor stays on the last column, pending a wrap which terminals
+					// handle differently
+					cursor_x_ = i;
+					cursor_is_known_ = i < width_;
+				}
+				return end;
+			}
+
+			void move_to(size_t x, size_t y) {
+				if (cursor_is_known_ && cursor_x_ == x && cursor_y_ == y) return;
+				char buffer[ECMA48::ControlSequence::MAX_LENGTH];
+				const char* end = cursor_is_known_ ? encode_cursor_movement(buffer, cursor_x_, cursor_y_, x, y)
+				                                   : ECMA48::ControlSequence::CUP.encode(buffer, y + 1, x + 1);
+				frame_.append(buffer, end - buffer);
+				cursor_is_known_ = true;
+				cursor_x_ = x;
+				cursor_y_ = y;
+			}
+
+			void set_rendition(const Rendition& rendition) {
+				if (rendition_is_known_ && rendition_ == rendition) return;
+				char buffer[MAX_TRANSITION_LENGTH];
+				const char* end = rendition_is_known_ ? encode_transition(buffer, rendition_, rendition)
+				                                      : encode_rendition(buffer, rendition);
+				frame_.append(buffer, end - buffer);
+				rendition_is_known_ = true;
+				rendition_ = rendition;
+			}
+
+			void append(const ECMA48::SequenceView& sequence) {
+				frame_.append(sequence.data(), sequence.size());
+			}
+
+			template <typename CONTROL_FUNCTION>
+			void append_sequence(const CONTROL_FUNCTION& f, size_t v) {
+				char buffer[ECMA48::ControlSequence::MAX_LENGTH];
+				frame_.append(buffer, f.encode(buffer, v) - buffer);
+			}
+
+			size_t width_;
+			size_t height_;
+			std::vector<Cell> back_;
+			std::vector<Cell> front_;
+			bool front_is_valid_;
+
+			// Terminal state while rendering
+			bool cursor_is_known_;
+			size_t cursor_x_;
+			size_t cursor_y_;
+			bool rendition_is_known_;
+			Rendition rendition_;
+			bool repeats_; // Whether runs of cells are written with REP
+
+			// Bytes of the frame being rendered, kept to reuse its capacity
+			std::string frame_;
+	};
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                 Color maps                                 //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ·································
+	// Utilities functions for colormaps
+
+	// Named rather than anonymous so that lookup tables built from these functions
+	// are shared by all translation units.
+	namespace colormap_functions {
+		inline float upramp(float x, float center, float width) {
+		    return 255.0f * (1.0f + std::tanh(6.0f / width * (x - center))) / 2.0f;
+		}
+
+		inline float downramp(float x, float center, float width) {
+		    return 255.0f * (1.0f - std::tanh(6.0f / width * (x - center))) / 2.0f;
+		}
+	}
+
+	// ·············
+	// Colormap data
+
+	namespace colormap_functions {
+		inline RGB hot_function(float x) {
+			return RGB(upramp(x, 1/6.0, 1/3.0),
+			           upramp(x, 1/2.0, 1/3.0),
+			           upramp(x, 5/6.0, 1/3.0));
+		}
+
+	    inline RGB jet_function(float x) {
+	        if (x <= 0.5)
+	            return RGB(upramp(x, 5/8.0, 1/4.0),
+	                       upramp(x, 1/8.0, 1/4.0),
+	                     downramp(x, 3/8.0, 1/4.0));
+	        else
+	            return RGB(upramp(x, 5/8.0, 1/4.0),
+	                     downramp(x, 7/8.0, 1/4.0),
+	                     downramp(x, 3/8.0, 1/4.0));
+	    }
+
+	    inline RGB hsv_function(float x) {
+	        if (x<=1/3.0)
+	            return RGB(downramp(x, 3/12.0, 1/6.0),
+	                         upramp(x, 1/12.0, 1/6.0),
+	                       0.0);
+	        else if (x<=2/3.0)
+	            return RGB(0.0,
+	                       downramp(x, 7/12.0, 1/6.0),
+	                         upramp(x, 5/12.0, 1/6.0));
+	        else
+	            return RGB(upramp(x, 9/12.0, 1/6.0),
+	                       0.0,
+	                       downramp(x, 11/12.0, 1/6.0));
+	    }
+
+	    inline RGB good_function(float x) {
+	        return RGB(downramp(x, 8/12.0, 2/3.0),
+	                     upramp(x, 4/12.0, 2/3.0),
+	                   0.0);
+	    }
+
+	    inline RGB gray_function(float x) {
+	        return RGB(x,x,x) * 255.0f;
+	    }
+	}
+
+	// –––––––––––––––––––––
+	// Colormap public tools
+
+	typedef RGB (*ColormapFunction)(float);
+
+	// Shared by all translation units
+	namespace detail {
+		// Colors of a colormap function sampled at SIZE evenly spaced values of
+		// [0,1], close enough for colors to be within 1 of the function's
+		struct ColormapTable {
+			static const size_t SIZE = 4096;
+
+			uint8_t rgb[SIZE][3];
+			uint8_t xterm256[SIZE];
+
+			explicit ColormapTable(ColormapFunction f) {
+				for (size_t i=0; i<SIZE; ++i) {
+					const RGB c = f(i / float(SIZE - 1));
+					// Truncated like the channels of dye::rgb()
+					rgb[i][0] = uint8_t(c.r);
+					rgb[i][1] = uint8_t(c.g);
+					rgb[i][2] = uint8_t(c.b);
+				}
+				xterm256::ECMA48_from_rgb_pixels(&rgb[0][0], SIZE, xterm256);
+			}
+
+			// Sample of x, clamped to [0,1], NaN mapping to 0
+			static size_t index(float x) {
+				if (!(x > 0.0f)) return 0;
+				if (x >= 1.0f) return SIZE - 1;
+				return size_t(x * (SIZE - 1) + 0.5f);
+			}
+		};
+
+		// Table of f, built on first use
+		inline const ColormapTable& colormap_table(ColormapFunction f) {
+			static std::mutex mutex;
+			static std::vector< std::pair< ColormapFunction, std::unique_ptr<ColormapTable> > > tables;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i=0; i<tables.size(); ++i)
+				if (tables[i].first == f) return *tables[i].second;
+			tables.push_back(std::make_pair(f, std::unique_ptr<ColormapTable>(new ColormapTable(f))));
+			return *tables.back().second;
+		}
+	}
+
+	class Colormap {
+		private:
+			inline float normalize(float x) const {
+				if (x < 0.0f) x = 0.0f;
+				if (x > 1.0f) x = 1.0f;
+				return x;
+			}
+
+		public:
+			constexpr Colormap(ColormapFunction f) : f_(f) {}
+
+			// operator()
+
+			ColorManipulator operator()(float x) const {
+				return dye::rgb(f_(normalize(x)));
+			}
+
+			ColorManipulator operator()(size_t percentage) const {
+				return operator()(percentage / 100.0f);
+			}
+
+			ColorManipulator operator()(int percentage) const {
+				return operator()(percentage / 100.0f);
+			}
+
+			// Color of x, clamped to [0,1]
+			RGB rgb(float x) const {
+				return f_(normalize(x));
+			}
+
+			// Batch evaluation: n values at xs, clamped to [0,1], are mapped through
+			// a table sampling the colormap 4096 times, built once per colormap
+			// function on first use. Channels are within 1 of operator()'s.
+
+			// Writes n r,g,b triplets at rgb_out, which must hold 3n bytes
+			void map(const float* xs, size_t n, uint8_t* rgb_out) const {
+				const detail::ColormapTable& table = detail::colormap_table(f_);
+				for (const float* const end = xs + n; xs != end; ++xs, rgb_out += 3) {
+					const uint8_t* rgb = table.rgb[detail::ColormapTable::index(*xs)];
+					rgb_out[0] = rgb[0];
+					rgb_out[1] = rgb[1];
+					rgb_out[2] = rgb[2];
+				}
+			}
+
+			// Writes n xterm256 indices at indices_out
+			void map_xterm256(const float* xs, size_t n, uint8_t* indices_out) const {
+				const detail::ColormapTable& table = detail::colormap_table(f_);
+				for (const float* const end = xs + n; xs != end; ++xs)
+					*indices_out++ = table.xterm256[detail::ColormapTable::index(*xs)];
+			}
+
+		private:
+			ColormapFunction f_;
+	};
+
+	// ·············
+	// Colormap LUTs
+
+	// Colormap sampled at a number of evenly spaced values of [0,1] chosen at
+	// runtime, with all sequences pre-encoded in one arena of cache-line aligned
+	// slots: a lookup reads one cache line and never allocates. Values are
+	// clamped to [0,1], and rounded to the nearest sample, NaN mapping to 0.
+	class BasicColormapLUT {
+		public:
+			BasicColormapLUT(const Colormap& c, size_t size)
+				: size_(size)
+				, storage_(new char[size * ColormapEntry::SLOT_SIZE + ColormapEntry::SLOT_SIZE - 1])
+				, rgb_(new uint8_t[3 * size])
+				{
+					assert(size >= 2);
+					const uintptr_t address = reinterpret_cast<uintptr_t>(storage_.get());
+					slots_ = storage_.get() + (-address & (ColormapEntry::SLOT_SIZE - 1));
+
+					for (size_t i=0; i<size; ++i) {
+						const RGB color = c.rgb(i / float(size - 1));
+						// Truncated like the channels of dye::rgb()
+						rgb_[3*i]   = uint8_t(color.r);
+						rgb_[3*i+1] = uint8_t(color.g);
+						rgb_[3*i+2] = uint8_t(color.b);
+					}
+					std::unique_ptr<uint8_t[]> indices(new uint8_t[size]);
+					xterm256::ECMA48_from_rgb_pixels(rgb_.get(), size, indices.get());
+
+					for (size_t i=0; i<size; ++i) {
+						const uint8_t* rgb = rgb_.get() + 3*i;
+						const ColorManipulator& indexed = detail::xterm256_table::entries[indices[i]];
+						char* slot = slots_ + i * ColormapEntry::SLOT_SIZE;
+						char* lengths = slot + ColormapEntry::LENGTHS;
+						lengths[0] = char(ECMA48::encode_foreground_24bit(slot + ColormapEntry::FG_24BIT, rgb[0], rgb[1], rgb[2])
+						                  - (slot + ColormapEntry::FG_24BIT));
+						lengths[1] = char(ECMA48::encode_background_24bit(slot + ColormapEntry::BG_24BIT, rgb[0], rgb[1], rgb[2])
+						                  - (slot + ColormapEntry::BG_24BIT));
+						lengths[2] = char(indexed.fg().size());
+						lengths[3] = char(indexed.bg().size());
+						std::memcpy(slot + ColormapEntry::FG_XTERM256, indexed.fg().data(), indexed.fg().size());
+						std::memcpy(slot + ColormapEntry::BG_XTERM256, indexed.bg().data(), indexed.bg().size());
+					}
+				}
+
+			BasicColormapLUT(ColormapFunction f, size_t size)
+				: BasicColormapLUT(Colormap(f), size)
+				{}
+
+			BasicColormapLUT(const BasicColormapLUT&) = delete;
+			BasicColormapLUT& operator=(const BasicColormapLUT&) = delete;
+
+			size_t size() const { return size_; }
+
+			// Sample of x
+			size_t index(float x) const {
+				if (!(x > 0.0f)) return 0;
+				if (x >= 1.0f) return size_ - 1;
+				return size_t(x * (size_ - 1) + 0.5f);
+			}
+
+			// Nearest sampling
+
+			ColormapEntry operator()(float x) const {
+				return ColormapEntry(slot(index(x)));
+			}
+
+			ColormapEntry operator()(size_t percentage) const {
+				return operator()(percentage / 100.0f);
+			}
+
+			ColormapEntry operator()(int percentage) const {
+				return operator()(percentage / 100.0f);
+			}
+
+			ColormapEntry bg(float x) const {
+				return ColormapEntry(slot(index(x)), true);
+			}
+
+			// Linear sampling, between the two nearest samples
+
+			ColormapBlend linear(float x, bool background = false) const {
+				if (!(x > 0.0f)) x = 0.0f;
+				if (x > 1.0f) x = 1.0f;
+				const float position = x * (size_ - 1);
+				const size_t i = std::min(size_t(position), size_ - 2);
+				const float t = position - i;
+				const uint8_t* a = rgb_.get() + 3*i;
+				const uint8_t* b = a + 3;
+				return ColormapBlend(lerp(a[0], b[0], t), lerp(a[1], b[1], t), lerp(a[2], b[2], t), background);
+			}
+
+		private:
+			const char* slot(size_t i) const {
+				return slots_ + i * ColormapEntry::SLOT_SIZE;
+			}
+
+			static uint8_t lerp(uint8_t a, uint8_t b, float t) {
+				return uint8_t(a + (b - a) * t + 0.5f);
+			}
+
+			size_t size_;
+			std::unique_ptr<char[]> storage_;
+			char* slots_;                   // First slot, aligned in storage_
+			std::unique_ptr<uint8_t[]> rgb_; // Colors of the samples, for linear sampling
+	};
+
+	// BasicColormapLUT of a size known at compile time
+	template <size_t SIZE>
+	class ColormapLUT : public BasicColormapLUT {
+		public:
+			ColormapLUT(ColormapFunction f)
+				: BasicColormapLUT(f, SIZE)
+				{}
+
+			ColormapLUT(const Colormap& c)
+				: BasicColormapLUT(c, SIZE)
+				{}
+	};
+
+	// ColormapLUT of a colormap function with external linkage, built on first use
+	// and shared by all translation units
+	template <size_t SIZE, ColormapFunction F>
+	class SharedColormapLUT {
+		public:
+			constexpr SharedColormapLUT() {}
+
+			const ColormapLUT<SIZE>& lut() const {
+				static const ColormapLUT<SIZE> lut(F);
+				return lut;
+			}
+
+			operator const ColormapLUT<SIZE>&() const { return lut(); }
+
+			// operator()
+
+			ColormapEntry operator()(float x) const {
+				return lut()(x);
+			}
+
+			ColormapEntry operator()(size_t percentage) const {
+				return lut()(percentage);
+			}
+
+			ColormapEntry operator()(int percentage) const {
+				return lut()(percentage);
+			}
+
+			ColormapEntry bg(float x) const {
+				return lut().bg(x);
+			}
+
+			ColormapBlend linear(float x, bool background = false) const {
+				return lut().linear(x, background);
+			}
+	};
+
+	// –––––––––
+	// Colormaps
+
+	const Colormap     hot(colormap_functions::hot_function);
+	const Colormap     jet(colormap_functions::jet_function);
+	const Colormap rainbow(colormap_functions::hsv_function);
+	const Colormap    good(colormap_functions::good_function);
+	const Colormap    gray(colormap_functions::gray_function);
+
+	const SharedColormapLUT<100, colormap_functions::hot_function>      hot100;
+	const SharedColormapLUT<100, colormap_functions::jet_function>      jet100;
+	const SharedColormapLUT<100, colormap_functions::hsv_function>  rainbow100;
+	const SharedColormapLUT<100, colormap_functions::good_function>    good100;
+	const SharedColormapLUT<100, colormap_functions::gray_function>    gray100;
+}
+
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+//                                  Heatmaps                                  //
+// –––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––– //
+
+namespace dye {
+	// ––––––––––––––––
+	// Helper functions
+
+	namespace {
+		// Color keys: 0xRRGGBB for 24-bit colors, the index for xterm256 colors
+		const uint32_t DEFAULT_HEATMAP_COLOR = 0xFFFFFFFF;
+
+		// Longest cell: both colors in 24-bit and a 3-byte glyph
+		const size_t MAX_HEATMAP_CELL_LENGTH = ECMA48::C1::LENGTH + 10 * 4 + 3;
+
+		// Color keys of the samples of colormap's table, see Colormap::map()
+		inline std::vector<uint32_t> heatmap_colors(const Colormap& colormap, bool truecolor) {
+			const size_t SIZE = detail::ColormapTable::SIZE;
+			std::vector<float> xs(SIZE);
+			for (size_t i=0; i<SIZE; ++i) xs[i] = i / float(SIZE - 1);
+
+			std::vector<uint32_t> colors(SIZE);
+			std::vector<uint8_t> buffer(3 * SIZE);
+			if (truecolor) {
+				colormap.map(xs.data(), SIZE, buffer.data());
+				for (size_t i=0; i<SIZE; ++i)
+					colors[i] = uint32_t(buffer[3*i]) << 16 | uint32_t(buffer[3*i+1]) << 8 | buffer[3*i+2];
+			} else {
+				colormap.map_xterm256(xs.data(), SIZE, buffer.data());
+				std::copy(buffer.begin(), buffer.begin() + SIZE, colors.begin());
+			}
+			return colors;
+		}
+
+		// SGR parameters selecting a color key
+		inline size_t heatmap_color_parameters(size_t* ps, uint32_t color, bool truecolor, bool background) {
+			if (color == DEFAULT_HEATMAP_COLOR) {
+				ps[0] = background ? 49 : 39;
+				return 1;
+			}
+			ps[0] = background ? 48 : 38;
+			if (!truecolor) {
+				ps[1] = 5;
+				ps[2] = color;
+				return 3;
+			}
+			ps[1] = 2;
+			ps[2] = color >> 16;
+			ps[3] = (color >> 8) & 0xFF;
+			ps[4] = color & 0xFF;
+			return 5;
+		}
+
+		// Colors of the terminal while a heatmap line is written
+		class HeatmapPen {
+			public:
+				explicit HeatmapPen(bool truecolor)
+					: truecolor_(truecolor)
+					, fg_(DEFAULT_HEATMAP_COLOR)
+					, bg_(DEFAULT_HEATMAP_COLOR)
+					{}
+
+				uint32_t fg() const { return fg_; }
+				uint32_t bg() const { return bg_; }
+
+				// Writes the SGR sequence setting the colors that differ
+				char* set(char* out, uint32_t fg, uint32_t bg) {
+					size_t ps[10];
+					size_t count = 0;
+					if (fg != fg_) count += heatmap_color_parameters(ps + count, fg, truecolor_, false);
+					if (bg != bg_) count += heatmap_color_parameters(ps + count, bg, truecolor_, true);
+					fg_ = fg;
+					bg_ = bg;
+					if (count == 0) return out;
+					return ECMA48::ControlSequence::encode(out, "m", ps, count);
+				}
+
+				char* reset(char* out) {
+					if (fg_ == DEFAULT_HEATMAP_COLOR && bg_ == DEFAULT_HEATMAP_COLOR) return out;
+					fg_ = bg_ = DEFAULT_HEATMAP_COLOR;
+					std::memcpy(out, ECMA48::reset.data(), ECMA48::reset.size());
+					return out + ECMA48::reset.size();
+				}
+
+			private:
+				bool truecolor_;
+				uint32_t fg_;
+				uint32_t bg_;
+		};
+
+		inline char* append_glyph(char* out, const char (&glyph)[4]) {
+			out[0] = glyph[0];
+			out[1] = glyph[1];
+			out[2] = glyph[2];
+			return out + 3;
+		}
+	}
+
+	// ––––––––––––––––
+	// Public interface
+
+	// Appends to frame the rows x cols matrix of values of [0,1] at data, stored
+	// row after row, drawn with colormap two rows per line: each character is an
+	// upper half block, U+2580, colored by the upper cell as foreground and by
+	// the lower cell as background. Cells of two equal colors are drawn as spaces
+	// or full blocks, and colors are only set when they change along a line,
+	// with a single SGR sequence. Lines end with a reset and a newline.
+	//
+	// 24-bit colors are used if the terminal supports them, and xterm256 colors
+	// otherwise, for the whole frame. Values are mapped like with Colormap::map(),
+	// whose table is looked up once per frame.
+	inline void heatmap(std::string& frame, const float* data, size_t rows, size_t cols, const Colormap& colormap) {
+		static const char UPPER_HALF_BLOCK[] = "▀";
+		static const char FULL_BLOCK[]       = "█";
+
+		const bool truecolor = is_24bit_capable();
+		const std::vector<uint32_t> colors = heatmap_colors(colormap, truecolor);
+
+		HeatmapPen pen(truecolor);
+		for (size_t y=0; y<rows; y+=2) {
+			const float* upper = data + y * cols;
+			const float* lower = y + 1 < rows ? upper + cols : 0;
+
+			const size_t line_start = frame.size();
+			frame.resize(line_start + cols * MAX_HEATMAP_CELL_LENGTH + ECMA48::reset.size() + 1);
+			char* out = &frame[line_start];
+
+			for (size_t x=0; x<cols; ++x) {
+				const uint32_t fg = colors[detail::ColormapTable::index(upper[x])];
+				const uint32_t bg = lower ? colors[detail::ColormapTable::index(lower[x])] : DEFAULT_HEATMAP_COLOR;
+				if (fg != bg) {
+					out = pen.set(out, fg, bg);
+					out = append_glyph(out, UPPER_HALF_BLOCK);
+				} else if (pen.bg() == bg) {
+					*out++ = ' ';
+				} else if (pen.fg() == fg) {
+					out = append_glyph(out, FULL_BLOCK);
+				} else {
+					out = pen.set(out, pen.fg(), bg);
+					*out++ = ' ';
+				}
+			}
+			out = pen.reset(out);
+			*out++ = '\n';
+			frame.resize(out - frame.data());
+		}
+	}
+
+	inline std::string heatmap(const float* data, size_t rows, size_t cols, const Colormap& colormap) {
+		std::string frame;
+		heatmap(frame, data, rows, cols, colormap);
+		return frame;
+	}
 }
 
 #endif
@@ -102,30 +102,35 @@ int main() {
 	std::cout << "––––––––––\n"
 	             "Color maps\n\n";
 
-	std::cout << std::setw(5) << "Hot" << ": ";
+	// Runs of one color are written as a single space followed by REP, on
+	// terminals supporting it
+	std::cout << dye::auto_repeat;
+	dye::StyledStream out(std::cout);
+
+	out << std::setw(5) << "Hot" << ": ";
 	for (size_t i=0; i<100; ++i)
-		std::cout << ~dye::hot(i)(" ");
-	std::cout << std::endl;
+		out << ~dye::hot(i)(" ");
+	out << std::endl;
 
-	std::cout << std::setw(5) << "Jet" << ": ";
+	out << std::setw(5) << "Jet" << ": ";
 	for (size_t i=0; i<100; ++i)
-		std::cout << ~dye::jet(i)(" ");
-	std::cout << std::endl;
+		out << ~dye::jet(i)(" ");
+	out << std::endl;
 
-	std::cout << std::setw(5) << "HSV" << ": ";
+	out << std::setw(5) << "HSV" << ": ";
 	for (size_t i=0; i<100; ++i)
-		std::cout << ~dye::rainbow(i)(" ");
-	std::cout << std::endl;
+		out << ~dye::rainbow(i)(" ");
+	out << std::endl;
 
-	std::cout << std::setw(5) << "Good" << ": ";
+	out << std::setw(5) << "Good" << ": ";
 	for (size_t i=0; i<100; ++i)
-		std::cout << ~dye::good(i)(" ");
-	std::cout << std::endl;
+		out << ~dye::good(i)(" ");
+	out << std::endl;
 
-	std::cout << std::setw(5) << "Gray" << ": ";
+	out << std::setw(5) << "Gray" << ": ";
 	for (size_t i=0; i<100; ++i)
-		std::cout << ~dye::gray(i)(" ");
-	std::cout << std::endl;
+		out << ~dye::gray(i)(" ");
+	out << std::endl;
 }
 
 //–––––––––––––––––––––––––––––––––––– ∎ –––––––––––––––––––––––––––––––––––––//
@@ -0,0 +1,105 @@
+// Logs styled records from several threads through AsyncLogger, to a file:
+// all records must be written, in order per thread, and no line may start
+// with the sequence resetting the style of the previous one. Then creates and destroys loggers repeatedly, with
+// a producer thread logging to each of them. Built with -fsanitize=address.
+
+#include "../dye.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+	const size_t THREADS = 4;
+	const size_t RECORDS = 5000;
+
+	const dye::ColorManipulator warning = ~dye::yellow;
+	const dye::Style error = dye::bold | dye::red;
+
+	std::string record(size_t thread, size_t i) {
+		std::ostringstream text;
+		text << "thread " << thread << " record " << i << "\n";
+		return text.str();
+	}
+
+	bool starts_with_reset(const std::string& line) {
+		const char* resets[] = { "\x1b[0m", "\x1b[39m", "\x1b[49m" };
+		for (size_t i=0; i<3; ++i)
+			if (line.compare(0, std::strlen(resets[i]), resets[i]) == 0) return true;
+		return false;
+	}
+
+	bool check_lines() {
+		char path[] = "/tmp/dye_async_logger_XXXXXX";
+		const int fd = mkstemp(path);
+		{
+			dye::AsyncLogger log(fd, dye::ALWAYS_COLOR, 1 << 20);
+			std::vector<std::thread> threads;
+			for (size_t t=0; t<THREADS; ++t)
+				threads.push_back(std::thread([&log, t]() {
+					for (size_t i=0; i<RECORDS; ++i) {
+						const std::string text = record(t, i);
+						switch (i % 4) {
+							case 0:  log.log(&dye::red, text); break;
+							case 1:  log.log(&warning, text); break;
+							case 2:  log.log(&error, text); break;
+							default: log.log(text); break;
+						}
+					}
+				}));
+			for (size_t t=0; t<THREADS; ++t) threads[t].join();
+			if (log.dropped() != 0) {
+				std::cerr << log.dropped() << " records dropped\n";
+				return false;
+			}
+		}
+		close(fd);
+
+		std::ifstream file(path);
+		std::remove(path);
+		std::vector<size_t> next(THREADS, 0);
+		std::string line;
+		size_t lines = 0;
+		while (std::getline(file, line)) {
+			if (starts_with_reset(line)) {
+				std::cerr << "line " << lines << " starts with a reset\n";
+				return false;
+			}
+			size_t t, i;
+			if (std::sscanf(dye::strip(line).c_str(), "thread %zu record %zu", &t, &i) != 2
+			    || t >= THREADS || i != next[t]++) {
+				std::cerr << "line " << lines << " out of order\n";
+				return false;
+			}
+			++lines;
+		}
+		if (lines != THREADS * RECORDS) {
+			std::cerr << lines << " lines instead of " << THREADS * RECORDS << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	// The producer's rings of destroyed loggers are released on its next record
+	bool check_logger_churn() {
+		const int fd = open("/dev/null", O_WRONLY);
+		for (size_t i=0; i<1000; ++i) {
+			dye::AsyncLogger log(fd, dye::ALWAYS_COLOR, 4096);
+			std::thread thread([&log]() { log.log(&dye::red, "record\n"); });
+			log.log("record\n");
+			thread.join();
+		}
+		close(fd);
+		return true;
+	}
+}
+
+int main() {
+	if (!check_lines() || !check_logger_churn()) return 1;
+	std::cout << "AsyncLogger: " << THREADS << " threads x " << RECORDS << " records: ok\n";
+	return 0;
+}
@@ -0,0 +1,99 @@
+// Compares Colormap::map() with the truncated channels of Colormap::rgb(),
+// which operator() writes, for every colormap: over a dense grid of [0,1],
+// random values, the pieces' boundaries of jet and rainbow, and values out
+// of range or NaN, which map like 0 and 1. map_xterm256() must give the
+// xterm256 indices of map()'s colors.
+
+#include "../dye.hpp"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+	const size_t DENSE = 1000000;
+	const size_t RANDOM = 1000000;
+
+	struct NamedColormap {
+		const char* name;
+		const dye::Colormap* colormap;
+	};
+
+	const NamedColormap COLORMAPS[] = {
+		{ "hot",     &dye::hot },
+		{ "jet",     &dye::jet },
+		{ "rainbow", &dye::rainbow },
+		{ "good",    &dye::good },
+		{ "gray",    &dye::gray }
+	};
+
+	// Values around x, and x itself
+	void add_neighbours(std::vector<float>& xs, float x) {
+		float below = x, above = x;
+		for (size_t i=0; i<4; ++i) {
+			below = std::nextafter(below, 0.0f);
+			above = std::nextafter(above, 1.0f);
+			xs.push_back(below);
+			xs.push_back(above);
+		}
+		xs.push_back(x);
+	}
+
+	// Value whose color operator() writes: NaN and values out of [0,1] are
+	// clamped as map() clamps them
+	float clamped(float x) {
+		if (!(x > 0.0f)) return 0.0f;
+		return x < 1.0f ? x : 1.0f;
+	}
+}
+
+int main() {
+	std::vector<float> xs;
+	for (size_t i=0; i<=DENSE; ++i) xs.push_back(i / float(DENSE));
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	for (size_t i=0; i<RANDOM; ++i) xs.push_back(uniform(random));
+	add_neighbours(xs, 0.5f);
+	add_neighbours(xs, 1 / 3.0f);
+	add_neighbours(xs, 2 / 3.0f);
+	xs.push_back(std::numeric_limits<float>::quiet_NaN());
+	xs.push_back(-0.5f);
+	xs.push_back(1.5f);
+	xs.push_back(-std::numeric_limits<float>::infinity());
+	xs.push_back(std::numeric_limits<float>::infinity());
+
+	std::vector<uint8_t> rgb(3 * xs.size());
+	std::vector<uint8_t> indices(xs.size());
+	size_t failures = 0;
+	for (size_t c=0; c<sizeof(COLORMAPS)/sizeof(COLORMAPS[0]); ++c) {
+		const dye::Colormap& colormap = *COLORMAPS[c].colormap;
+		colormap.map(xs.data(), xs.size(), rgb.data());
+		colormap.map_xterm256(xs.data(), xs.size(), indices.data());
+
+		int worst = 0;
+		size_t mismatches = 0;
+		for (size_t i=0; i<xs.size(); ++i) {
+			const dye::RGB expected = colormap.rgb(clamped(xs[i]));
+			const int channels[3] = { int(expected.r), int(expected.g), int(expected.b) };
+			for (size_t k=0; k<3; ++k) {
+				const int difference = std::abs(int(rgb[3*i + k]) - channels[k]);
+				worst = std::max(worst, difference);
+				if (difference > 1 && ++mismatches <= 5)
+					std::cerr << COLORMAPS[c].name << "(" << xs[i] << "): channel " << k << " is "
+					          << int(rgb[3*i + k]) << " instead of " << channels[k] << "\n";
+			}
+			const size_t index = dye::xterm256::ECMA48_from_rgb(rgb[3*i], rgb[3*i + 1], rgb[3*i + 2]);
+			if (indices[i] != index && ++mismatches <= 5)
+				std::cerr << COLORMAPS[c].name << "(" << xs[i] << "): index " << int(indices[i])
+				          << " instead of " << index << "\n";
+		}
+		if (mismatches != 0) {
+			std::cerr << COLORMAPS[c].name << ": " << mismatches << " mismatches\n";
+			++failures;
+		}
+		std::cout << "Colormap::map " << COLORMAPS[c].name << ": " << xs.size()
+		          << " values, worst difference " << worst << (mismatches == 0 ? ": ok\n" : "\n");
+	}
+	return failures != 0;
+}
@@ -0,0 +1,67 @@
+// Checks that the precomputed and the encoded forms of control sequences are
+// the same bytes, and that every instance precomputes its own defaults.
+
+#include "../dye.hpp"
+#include <iostream>
+
+namespace {
+	size_t failures = 0;
+
+	// ESC written as \e
+	std::string visible(const std::string& sequence) {
+		std::string s;
+		for (size_t i=0; i<sequence.size(); ++i) {
+			if (sequence[i] == '\x1b') s += "\\e";
+			else s += sequence[i];
+		}
+		return s;
+	}
+
+	void check(const std::string& name, const std::string& sequence, const std::string& expected) {
+		if (sequence == expected) return;
+		++failures;
+		std::cerr << name << ": " << visible(sequence) << " instead of "
+		          << visible(expected) << "\n";
+	}
+
+	template <typename SEQUENCE>
+	std::string str(const SEQUENCE& sequence) {
+		return std::string(sequence.data(), sequence.size());
+	}
+}
+
+int main() {
+	namespace CS = dye::ECMA48::ControlSequence;
+	char buffer[CS::MAX_LENGTH];
+
+	// (Pn1;Pn2): trailing separators of default parameters are omitted
+	check("CUP()",     str(CS::CUP()),  "\x1b[H");
+	check("CUP(1,1)",  CS::CUP(1, 1),   "\x1b[H");
+	check("CUP(3,1)",  CS::CUP(3, 1),   "\x1b[3H");
+	check("CUP(1,7)",  CS::CUP(1, 7),   "\x1b[;7H");
+	check("CUP(3,7)",  CS::CUP(3, 7),   "\x1b[3;7H");
+	check("CUP.encode(1,1)", std::string(buffer, CS::CUP.encode(buffer, 1, 1)), str(CS::CUP()));
+	check("HVP()",     str(CS::HVP()),  std::string(buffer, CS::HVP.encode(buffer, 1, 1)));
+	check("GSM()",     str(CS::GSM()),  std::string(buffer, CS::GSM.encode(buffer, 100, 100)));
+
+	// (Pn)
+	check("CUU()",     str(CS::CUU()),  "\x1b[A");
+	check("CUU(1)",    CS::CUU(1),      "\x1b[A");
+	check("CUU(4)",    CS::CUU(4),      "\x1b[4A");
+
+	// Defaults belong to each instance, not to their class
+	check("CUD()",     str(CS::CUD()),  "\x1b[B");
+	check("CUF()",     str(CS::CUF()),  "\x1b[C");
+	check("HVP()",     str(CS::HVP()),  "\x1b[f");
+	check("SEE()",     str(CS::SEE()),  "\x1b[Q");
+	check("SRS()",     str(CS::SRS()),  "\x1b[[");
+	check("SPD()",     str(CS::SPD()),  "\x1b[; S");
+	check("SEF()",     str(CS::SEF()),  "\x1b[; Y");
+	check("SPD.encode(0,0)", std::string(buffer, CS::SPD.encode(buffer, 0, 0)), str(CS::SPD()));
+	check("CTC()",     str(CS::CTC()),  "\x1b[0W");
+	check("SGR()",     str(CS::SGR()),  "\x1b[0m");
+
+	if (failures != 0) return 1;
+	std::cout << "Control sequences: ok\n";
+	return 0;
+}
@@ -0,0 +1,84 @@
+// Counts the display columns of ASCII, wide, zero-width and malformed UTF-8
+// text, with and without control functions, then pads colored text with
+// align_left and align_right.
+
+#include "../dye.hpp"
+#include <iostream>
+
+namespace {
+	struct Case {
+		const char* text;
+		size_t width;
+	};
+
+	const Case CASES[] = {
+		{ "", 0 },
+		{ "abc", 3 },
+		// Longer than the 16 bytes counted at once, and interrupted by a
+		// character which is not printable ASCII
+		{ "The quick brown fox jumps over the lazy dog", 43 },
+		{ "The quick brown fox\xC3\xA9 jumps over the lazy dog", 44 },
+		{ "a\tb\x7F" "c", 3 },
+		// CJK, fullwidth forms and emoji take 2 columns
+		{ "\xE6\x97\xA5\xE6\x9C\xAC", 4 },
+		{ "\xEF\xBC\xA1", 2 },
+		{ "\xF0\x9F\x98\x80", 2 },
+		// Combining marks, zero-width and format characters take none
+		{ "e\xCC\x81", 1 },
+		{ "\xE2\x80\x8B", 0 },
+		{ "\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9", 4 },
+		{ "\xEF\xBB\xBF" "a", 1 },
+		// Malformed UTF-8 takes one column per byte: lone continuation and
+		// invalid bytes, truncated, overlong and surrogate sequences
+		{ "\x80" "a", 2 },
+		{ "\xFF\xFE" "a", 3 },
+		{ "\xE6\x97", 2 },
+		{ "\xC3", 1 },
+		{ "a\xC0\xAF" "b", 4 },
+		{ "\xED\xA0\x80", 3 },
+		// SGR, OSC and other control functions take none
+		{ "\x1b[31mred\x1b[0m", 3 },
+		{ "\x1b[38:2::1:2:3m\xE6\x97\xA5\x1b[m", 2 },
+		{ "\x1b]0;title\x07" "ab", 2 },
+		{ "\x1b]8;;http://example.com\x1b\\link\x1b]8;;\x1b\\", 4 },
+		{ "\x1b[2J\x1b" "c\x1b[5Ax", 1 },
+		{ "\xC2\x9B" "1mx", 1 }
+	};
+
+	size_t failures = 0;
+
+	void check(const std::string& name, const std::string& actual, const std::string& expected) {
+		if (actual == expected) return;
+		if (++failures <= 10)
+			std::cerr << name << ": \"" << actual << "\" instead of \"" << expected << "\"\n";
+	}
+}
+
+int main() {
+	const size_t count = sizeof(CASES) / sizeof(CASES[0]);
+	for (size_t i=0; i<count; ++i) {
+		const size_t width = dye::display_width(CASES[i].text);
+		if (width != CASES[i].width && ++failures <= 10)
+			std::cerr << "case " << i << ": " << width << " columns instead of " << CASES[i].width << "\n";
+	}
+
+	// Padding counts columns, not the bytes of characters and sequences
+	std::ostringstream colored;
+	colored << dye::always_color << "[" << dye::align_right(dye::red("\xE6\x97\xA5\xE6\x9C\xAC"), 6) << "]"
+	        << "[" << std::setfill('.') << dye::align_left(dye::red(42), 4) << "]"
+	        << "[" << dye::align_right("toolong", 3) << "]";
+	check("colored", colored.str(),
+	      "[  \x1b[31m\xE6\x97\xA5\xE6\x9C\xAC\x1b[39m][\x1b[31m" "42\x1b[39m..][toolong]");
+
+	std::ostringstream plain;
+	plain << dye::never_color << "[" << dye::align_right(dye::red("\xE6\x97\xA5"), 4) << "]"
+	      << "[" << dye::align_left(dye::red("e\xCC\x81"), 3) << "]";
+	check("plain", plain.str(), "[  \xE6\x97\xA5][e\xCC\x81  ]");
+
+	if (failures != 0) {
+		std::cerr << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "display_width: " << count << " cases, align_left/align_right: ok\n";
+	return 0;
+}
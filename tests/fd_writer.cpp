@@ -0,0 +1,65 @@
+// Writes small and large payloads through an FdWriter to a file: small ones
+// stay in the buffer until it is flushed, large ones are written at once by
+// writev(2) after the buffered bytes, without being copied into the buffer.
+
+#include "../dye.hpp"
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+	const size_t CAPACITY = 64 * 1024;
+
+	size_t file_size(int fd) {
+		struct stat status;
+		fstat(fd, &status);
+		return size_t(status.st_size);
+	}
+
+	std::string read_file(int fd) {
+		std::string content(file_size(fd), '\0');
+		if (pread(fd, &content[0], content.size(), 0) != ssize_t(content.size())) return std::string();
+		return content;
+	}
+}
+
+int main() {
+	char path[] = "/tmp/dye_fd_writer_XXXXXX";
+	const int fd = mkstemp(path);
+	unlink(path);
+
+	std::string large(40 * 1000, ' ');
+	for (size_t i=0; i<large.size(); ++i) large[i] = char('a' + i % 26);
+
+	size_t failures = 0;
+	{
+		dye::FdWriter out(fd, CAPACITY);
+		out << "head ";
+		if (file_size(fd) != 0) {
+			std::cerr << "small payload written before flush\n";
+			++failures;
+		}
+
+		// Fits in the free space, but is at least half the buffer
+		out << large;
+		if (file_size(fd) != 5 + large.size()) {
+			std::cerr << file_size(fd) << " bytes written instead of " << 5 + large.size()
+			          << ": the large payload was buffered\n";
+			++failures;
+		}
+
+		out << " tail";
+		out.flush();
+		if (!out.good()) ++failures;
+	}
+
+	if (read_file(fd) != "head " + large + " tail") {
+		std::cerr << "bytes out of order\n";
+		++failures;
+	}
+	close(fd);
+
+	if (failures != 0) return 1;
+	std::cout << "FdWriter: ok\n";
+	return 0;
+}
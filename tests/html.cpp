@@ -0,0 +1,111 @@
+// Converts ECMA-48 text to HTML with inline styles and with CSS classes, and
+// compares with the expected fragments. Every input is also fed in chunks of
+// every size, which must give the same HTML.
+
+#include "../dye.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+	struct Case {
+		const char* input;
+		const char* inline_styles;
+		const char* css_classes;
+	};
+
+	const Case CASES[] = {
+		// Escaping
+		{ "a & b < c > d",
+		  "a &amp; b &lt; c &gt; d",
+		  "a &amp; b &lt; c &gt; d" },
+		// One span however many sequences select its rendition, none when no
+		// text follows a change
+		{ "\x1b[31mre\x1b[31md\x1b[0m\x1b[0m plain",
+		  "<span style=\"color:#cd0000;\">red</span> plain",
+		  "<span class=\"dye-fg-1\">red</span> plain" },
+		{ "\x1b[31m\x1b[0mx",
+		  "x",
+		  "x" },
+		{ "\x1b[1;31;44mx\x1b[m",
+		  "<span style=\"color:#cd0000;background-color:#0000ee;font-weight:bold;\">x</span>",
+		  "<span class=\"dye-bold dye-fg-1 dye-bg-4\">x</span>" },
+		// NEGATIVE swaps colors, the page's for default ones
+		{ "\x1b[7mneg\x1b[0m",
+		  "<span style=\"color:Canvas;background-color:CanvasText;\">neg</span>",
+		  "<span class=\"dye-negative\">neg</span>" },
+		{ "\x1b[7;32mx\x1b[m",
+		  "<span style=\"color:Canvas;background-color:#00cd00;\">x</span>",
+		  "<span class=\"dye-negative dye-bg-2\">x</span>" },
+		{ "\x1b[8mhid\x1b[m",
+		  "<span style=\"color:transparent;\">hid</span>",
+		  "<span class=\"dye-concealed\">hid</span>" },
+		// Lines share one text-decoration
+		{ "\x1b[4;9;53mx\x1b[m",
+		  "<span style=\"text-decoration:underline line-through overline;\">x</span>",
+		  "<span class=\"dye-underlined dye-crossed dye-overlined\" style=\"text-decoration:underline line-through overline;\">x</span>" },
+		{ "\x1b[4mx\x1b[m",
+		  "<span style=\"text-decoration:underline;\">x</span>",
+		  "<span class=\"dye-underlined\">x</span>" },
+		// 24-bit colors, with ITU T.416 sub-parameters or separated parameters
+		{ "\x1b[38:2::1:2:3mx\x1b[m",
+		  "<span style=\"color:#010203;\">x</span>",
+		  "<span style=\"color:#010203;\">x</span>" },
+		{ "\x1b[38;2;1;2;3;48;5;196mx\x1b[m",
+		  "<span style=\"color:#010203;background-color:#ff0000;\">x</span>",
+		  "<span class=\"dye-bg-196\" style=\"color:#010203;\">x</span>" },
+		// Other control functions are dropped, LF and HT are kept
+		{ "\x1b[1m\x1b]0;t\x07\x1b[2Jb\x1b[22mc\r\n\t",
+		  "<span style=\"font-weight:bold;\">b</span>c\n\t",
+		  "<span class=\"dye-bold\">b</span>c\n\t" }
+	};
+
+	std::string convert_in_chunks(const std::string& s, size_t chunk, dye::HtmlStyling styling) {
+		std::string out;
+		dye::HtmlConverter converter(styling);
+		for (size_t i=0; i<s.size(); i+=chunk)
+			converter.feed(s.data() + i, std::min(chunk, s.size() - i),
+			               [&out](const char* html, size_t size) { out.append(html, size); });
+		converter.finish([&out](const char* html, size_t size) { out.append(html, size); });
+		return out;
+	}
+
+	size_t failures = 0;
+
+	void check(size_t i, size_t chunk, dye::HtmlStyling styling, const std::string& input, const std::string& expected) {
+		const std::string html = chunk == 0 ? dye::html(input, styling) : convert_in_chunks(input, chunk, styling);
+		if (html == expected) return;
+		if (++failures <= 10)
+			std::cerr << "case " << i << (styling == dye::CSS_CLASSES ? ", CSS classes" : "")
+			          << ", chunks of " << chunk << ":\n" << html << "\ninstead of\n" << expected << "\n";
+	}
+}
+
+int main() {
+	const size_t count = sizeof(CASES) / sizeof(CASES[0]);
+	std::string all_input, all_inline, all_classes;
+	for (size_t i=0; i<count; ++i) {
+		const std::string input = CASES[i].input;
+		for (size_t chunk=0; chunk<=input.size(); ++chunk) {
+			check(i, chunk, dye::INLINE_STYLES, input, CASES[i].inline_styles);
+			check(i, chunk, dye::CSS_CLASSES, input, CASES[i].css_classes);
+		}
+		all_input += input;
+	}
+
+	// Cases one after the other, as each ends in the default rendition
+	for (size_t i=0; i<count; ++i) {
+		all_inline += CASES[i].inline_styles;
+		all_classes += CASES[i].css_classes;
+	}
+	for (size_t chunk=0; chunk<=all_input.size(); ++chunk) {
+		check(count, chunk, dye::INLINE_STYLES, all_input, all_inline);
+		check(count, chunk, dye::CSS_CLASSES, all_input, all_classes);
+	}
+
+	if (failures != 0) {
+		std::cerr << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "HTML: " << count << " cases: ok\n";
+	return 0;
+}
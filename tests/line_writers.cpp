@@ -0,0 +1,89 @@
+// Writes styled Lines from 64 threads at once to a file opened with O_APPEND:
+// every line must come out whole, in order per thread, and close only the
+// style it left open. Then prints the lines per second written to /dev/null
+// by 1 and 64 writers, for comparison; no lock is taken, but write(2) calls
+// to one file are still serialized by the kernel.
+
+#include "../dye.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+	const size_t WRITERS = 64;
+	const size_t LINES = 2000;
+
+	void write_lines(int fd, size_t writer, size_t lines) {
+		for (size_t i=0; i<lines; ++i) {
+			dye::Line line(fd, dye::ALWAYS_COLOR);
+			line << dye::red("writer") << ' ' << writer << ' ' << (~dye::blue)("line") << ' ' << i;
+			// Odd lines leave yellow set, even lines restore the default color
+			if (i % 2) line << " open" << dye::yellow << '\n';
+			else line << dye::reset << '\n';
+		}
+	}
+
+	std::string expected_line(size_t writer, size_t i) {
+		std::ostringstream line;
+		line << "\x1b[31mwriter\x1b[39m " << writer << " \x1b[44mline\x1b[49m " << i;
+		if (i % 2) line << " open\x1b[33m\x1b[0m";
+		else line << "\x1b[39m";
+		return line.str();
+	}
+
+	// Lines per second written by the given number of writers
+	double throughput(int fd, size_t writers) {
+		const size_t lines = 64 * LINES / writers;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (size_t w=0; w<writers; ++w)
+			threads.push_back(std::thread(write_lines, fd, w, lines));
+		for (size_t w=0; w<writers; ++w) threads[w].join();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return writers * lines / elapsed.count();
+	}
+}
+
+int main() {
+	char path[] = "/tmp/dye_line_writers_XXXXXX";
+	const int fd = mkstemp(path);
+	fcntl(fd, F_SETFL, O_APPEND);
+	std::vector<std::thread> threads;
+	for (size_t w=0; w<WRITERS; ++w)
+		threads.push_back(std::thread(write_lines, fd, w, LINES));
+	for (size_t w=0; w<WRITERS; ++w) threads[w].join();
+	close(fd);
+
+	std::ifstream file(path);
+	std::remove(path);
+	std::vector<size_t> next(WRITERS, 0);
+	std::string line;
+	size_t lines = 0;
+	size_t mismatches = 0;
+	while (std::getline(file, line)) {
+		size_t w, i;
+		if (std::sscanf(dye::strip(line).c_str(), "writer %zu line %zu", &w, &i) != 2
+		    || w >= WRITERS || i != next[w]++ || line != expected_line(w, i)) {
+			if (++mismatches <= 10) std::cerr << "line " << lines << ": " << dye::strip(line) << "\n";
+		}
+		++lines;
+	}
+	if (mismatches != 0 || lines != WRITERS * LINES) {
+		std::cerr << mismatches << " mismatches, " << lines << " lines instead of " << WRITERS * LINES << "\n";
+		return 1;
+	}
+
+	const int null = open("/dev/null", O_WRONLY);
+	const double single = throughput(null, 1);
+	const double all = throughput(null, WRITERS);
+	close(null);
+	std::cout << "Line: " << WRITERS << " writers x " << LINES << " lines: ok ("
+	          << int(single / 1000) << "k lines/s with 1 writer, "
+	          << int(all / 1000) << "k with " << WRITERS << ")\n";
+	return 0;
+}
@@ -0,0 +1,199 @@
+// Renders frames of a 200x60 dashboard and replays the bytes written onto a
+// grid with ECMA48::Tokenizer, interpreting cursor movements, EL, ECH, REP
+// and SGR: the grid must look like the back buffer after every frame. An
+// unchanged frame must write nothing, and a few changed values little.
+
+#include "../dye.hpp"
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+	const size_t WIDTH = 200;
+	const size_t HEIGHT = 60;
+
+	// Most bytes for a frame changing a handful of cells
+	const size_t MAX_SMALL_FRAME = 128;
+
+	// Terminal interpreting what Screen writes. The cursor stays on the last
+	// column after it is written, which Screen never writes past.
+	class Terminal {
+		public:
+			Terminal() : cells_(WIDTH * HEIGHT), x_(0), y_(0), last_(' '), unknown_(0) {}
+
+			void replay(const std::string& bytes) {
+				dye::ECMA48::Tokenizer tokenizer;
+				tokenizer.feed(bytes.data(), bytes.size(), [this](const dye::ECMA48::Token& token) { on_token(token); });
+				tokenizer.finish([this](const dye::ECMA48::Token& token) { on_token(token); });
+			}
+
+			const dye::Cell& operator()(size_t x, size_t y) const { return cells_[y * WIDTH + x]; }
+
+			size_t unknown() const { return unknown_; }
+
+		private:
+			void on_token(const dye::ECMA48::Token& token) {
+				typedef dye::ECMA48::Token Token;
+				switch (token.kind) {
+					case Token::TEXT: {
+						const char* p = token.bytes.data();
+						const char* const end = p + token.bytes.size();
+						while (p != end) put(dye::utf8::decode(p, end));
+						break;
+					}
+					case Token::C0_CONTROL:
+						if (token.function == '\r') x_ = 0;
+						else if (token.function == '\n') y_ = std::min(y_ + 1, HEIGHT - 1);
+						else if (token.function == '\b') x_ = x_ > 0 ? x_ - 1 : 0;
+						else ++unknown_;
+						break;
+					case Token::CONTROL_SEQUENCE:
+						control_sequence(token);
+						break;
+					default:
+						++unknown_;
+						break;
+				}
+			}
+
+			void control_sequence(const dye::ECMA48::Token& token) {
+				const size_t n = token.parameter(0, 1);
+				switch (token.function) {
+					case 'A': y_ = y_ > n ? y_ - n : 0; break;
+					case 'B': y_ = std::min(y_ + n, HEIGHT - 1); break;
+					case 'C': x_ = std::min(x_ + n, WIDTH - 1); break;
+					case 'D': x_ = x_ > n ? x_ - n : 0; break;
+					case 'E': y_ = std::min(y_ + n, HEIGHT - 1); x_ = 0; break;
+					case 'F': y_ = y_ > n ? y_ - n : 0; x_ = 0; break;
+					case 'G': x_ = std::min(n, WIDTH) - 1; break;
+					case 'd': y_ = std::min(n, HEIGHT) - 1; break;
+					case 'H':
+						y_ = std::min(n, HEIGHT) - 1;
+						x_ = std::min(token.parameter(1, 1), WIDTH) - 1;
+						break;
+					case 'J':
+						if (token.parameter(0, 0) != 2) ++unknown_;
+						std::fill(cells_.begin(), cells_.end(), erased());
+						break;
+					case 'K':
+						if (token.parameter(0, 0) != 0) ++unknown_;
+						erase(x_, WIDTH);
+						break;
+					case 'X': erase(x_, std::min(x_ + n, WIDTH)); break;
+					case 'b': for (size_t i=0; i<n; ++i) put(last_); break;
+					case 'm': rendition_.apply(token); break;
+					default:  ++unknown_; break;
+				}
+			}
+
+			void put(uint32_t c) {
+				cells_[y_ * WIDTH + std::min(x_, WIDTH - 1)] = dye::Cell(c, rendition_);
+				x_ = std::min(x_ + 1, WIDTH);
+				last_ = c;
+			}
+
+			// Erased cells only take the background color
+			dye::Cell erased() const {
+				dye::Rendition rendition;
+				rendition.bg = rendition_.bg;
+				return dye::Cell(' ', rendition);
+			}
+
+			void erase(size_t from, size_t to) {
+				for (size_t x=from; x<to; ++x) cells_[y_ * WIDTH + x] = erased();
+			}
+
+			std::vector<dye::Cell> cells_;
+			size_t x_;
+			size_t y_;
+			uint32_t last_;
+			dye::Rendition rendition_;
+			size_t unknown_; // Controls Screen should not write
+	};
+
+	// Blanks only show their background
+	bool looks_same(const dye::Cell& a, const dye::Cell& b) {
+		if (a.is_blank() && b.is_blank()) return a.rendition.bg == b.rendition.bg;
+		return a == b;
+	}
+
+	size_t failures = 0;
+
+	// Renders the screen, replays the frame and compares; returns its size
+	size_t render(const char* name, dye::Screen& screen, Terminal& terminal, std::ostream& stream) {
+		std::ostringstream frame;
+		frame.copyfmt(stream);
+		screen.render(frame);
+		terminal.replay(frame.str());
+
+		size_t mismatches = 0;
+		for (size_t y=0; y<HEIGHT; ++y)
+			for (size_t x=0; x<WIDTH; ++x)
+				if (!looks_same(terminal(x, y), screen(x, y)) && ++mismatches <= 5)
+					std::cerr << name << ": cell " << x << "," << y << " differs\n";
+		if (mismatches != 0 || terminal.unknown() != 0) {
+			std::cerr << name << ": " << mismatches << " cells differ, "
+			          << terminal.unknown() << " unexpected controls\n";
+			++failures;
+		}
+		return frame.str().size();
+	}
+
+	void draw_dashboard(dye::Screen& screen) {
+		const dye::Style title = dye::bold | dye::white | ~dye::blue;
+		screen.clear();
+		for (size_t x=0; x<WIDTH; ++x) screen(x, 0) = dye::Cell(' ', title.applied_to(dye::Rendition()));
+		screen.print(2, 0, "Dashboard \xe2\x80\x94 200x60", title);
+		for (size_t y=2; y<HEIGHT; ++y) {
+			std::ostringstream label;
+			label << "metric " << y << ":";
+			screen.print(2, y, label.str());
+			screen.print(20, y, "0.00", dye::Style(dye::green));
+			// Bars of one repeated character
+			screen.print(40, y, std::string(3 * (y % 40), '#').substr(0, 120), dye::Style(dye::red));
+		}
+	}
+}
+
+int main() {
+	dye::Screen screen(WIDTH, HEIGHT);
+	Terminal terminal;
+
+	for (size_t repeats=0; repeats<2; ++repeats) {
+		std::ostringstream stream;
+		if (repeats) stream << dye::always_color << dye::always_repeat;
+		screen.invalidate();
+		draw_dashboard(screen);
+		const size_t first = render("first frame", screen, terminal, stream);
+
+		const size_t unchanged = render("unchanged frame", screen, terminal, stream);
+		if (unchanged != 0) {
+			std::cerr << "unchanged frame: " << unchanged << " bytes\n";
+			++failures;
+		}
+
+		// A few values change
+		screen.print(20, 10, "1.25", dye::Style(dye::green));
+		screen.print(20, 31, "7.50", dye::Style(dye::yellow));
+		screen.print(22, 45, "9", dye::Style(dye::green));
+		const size_t small = render("small frame", screen, terminal, stream);
+		if (small == 0 || small > MAX_SMALL_FRAME) {
+			std::cerr << "small frame: " << small << " bytes\n";
+			++failures;
+		}
+
+		// Bars shrink and grow, rows are erased to their end and in their middle
+		for (size_t y=2; y<HEIGHT; y+=3)
+			screen.print(40, y, std::string(3 * ((y + 7) % 40), '=') + std::string(30, ' '), dye::Style(dye::red));
+		for (size_t x=0; x<WIDTH; ++x) screen(x, 5) = dye::Cell();
+		for (size_t x=30; x<70; ++x) screen(x, 6) = dye::Cell();
+		const size_t changes = render("changed frame", screen, terminal, stream);
+
+		std::cout << "Screen" << (repeats ? " with REP" : "") << ": " << first << " bytes, then "
+		          << unchanged << ", " << small << " and " << changes << "\n";
+	}
+
+	if (failures != 0) return 1;
+	std::cout << "Screen: ok\n";
+	return 0;
+}
@@ -0,0 +1,62 @@
+// Strips control functions, 7-bit and UTF-8 encoded, from inputs fed whole
+// and in chunks of every small size: sequences split across chunks must be
+// stripped as if they were not.
+
+#include "../dye.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+	struct Case {
+		const char* input;
+		const char* expected;
+	};
+
+	const Case CASES[] = {
+		{ "\x1b[31mred\x1b[0m text\n",            "red text\n" },
+		{ "a\x1b]0;title\x07" "b",                "ab" },
+		{ "a\x1bP" "q#0\x1b\\b",                  "ab" },
+		{ "a\x1b" "cb\x1b(B",                     "ab" },
+		{ "c\xc2\x9b" "2Jd",                      "cd" },   // CSI
+		{ "a\xc2\x9d" "0;title\x07" "b",          "ab" },   // OSC
+		{ "a\xc2\x90" "q#0\xc2\x9c" "b",          "ab" },   // DCS and ST
+		{ "a\xc2\x9e" "pm\x1b\\b",                "ab" },   // PM
+		{ "a\xc2\x9f" "apc\xc2\x9c" "b",          "ab" },   // APC
+		{ "a\xc2\x98" "sos\xc2\x9c" "b",          "ab" },   // SOS
+		{ "a\xc2\x85" "b",                        "ab" },   // NEL
+		{ "a\x1b[3\xc2\x9b" "1mb",                "ab" },   // CSI cut short by CSI
+		{ "\xc2\xa9 \xc2\xa0x\xc2",               "\xc2\xa9 \xc2\xa0x\xc2" },
+		{ "a\x1b[3\xc2\xa9" "b",                  "a\xc2\xa9" "b" },
+		{ "tab\tnewline\n\x1b[",                  "tab\tnewline\n" }
+	};
+
+	std::string strip_in_chunks(const std::string& s, size_t chunk) {
+		std::string out;
+		dye::Stripper stripper;
+		for (size_t i=0; i<s.size(); i+=chunk)
+			stripper.feed(s.data() + i, std::min(chunk, s.size() - i),
+			              [&out](const char* text, size_t length) { out.append(text, length); });
+		stripper.finish([&out](const char* text, size_t length) { out.append(text, length); });
+		return out;
+	}
+}
+
+int main() {
+	const size_t count = sizeof(CASES) / sizeof(CASES[0]);
+	size_t mismatches = 0;
+	for (size_t i=0; i<count; ++i) {
+		const std::string input = CASES[i].input;
+		for (size_t chunk=0; chunk<=input.size(); ++chunk) {
+			const std::string stripped = chunk == 0 ? dye::strip(input) : strip_in_chunks(input, chunk);
+			if (stripped != CASES[i].expected && ++mismatches <= 10)
+				std::cerr << "case " << i << ", chunks of " << chunk << ": "
+				          << stripped.size() << " bytes, expected " << std::strlen(CASES[i].expected) << "\n";
+		}
+	}
+	if (mismatches != 0) {
+		std::cerr << mismatches << " mismatches\n";
+		return 1;
+	}
+	std::cout << "strip: " << count << " cases: ok\n";
+	return 0;
+}
@@ -0,0 +1,73 @@
+// Composes Styles with | and checks the single SGR sequence each one writes,
+// and the rendition it gives when applied.
+
+#include "../dye.hpp"
+#include <iostream>
+#include <sstream>
+
+namespace {
+	size_t failures = 0;
+
+	std::string escaped(const std::string& s) {
+		std::string out;
+		for (size_t i=0; i<s.size(); ++i)
+			if (s[i] == '\x1b') out += "\\e";
+			else                out += s[i];
+		return out;
+	}
+
+	void check(const char* name, const std::string& actual, const std::string& expected) {
+		if (actual != expected && ++failures <= 10)
+			std::cerr << name << ": \"" << escaped(actual) << "\" instead of \"" << escaped(expected) << "\"\n";
+	}
+
+	void check(const char* name, const dye::Style& style, const std::string& expected) {
+		check(name, std::string(style.sequence().data(), style.sequence().size()), expected);
+	}
+
+	dye::Style sgr(const char* sequence) {
+		return dye::Style(dye::ECMA48::SequenceView(sequence, std::strlen(sequence)));
+	}
+}
+
+int main() {
+	check("bold | red | ~blue", dye::bold | dye::red | ~dye::blue, "\x1b[1;31;44m");
+	check("~blue | red | bold", ~dye::blue | dye::red | dye::bold, "\x1b[1;31;44m");
+	check("empty", dye::Style(), "");
+
+	// Later styles take precedence
+	check("red | green", dye::red | dye::green, "\x1b[32m");
+	check("bold | SGR 22", dye::bold | sgr("\x1b[22m"), "\x1b[22m");
+	// Faint stays off
+	check("SGR 22 | bold", sgr("\x1b[22m") | dye::bold, "\x1b[22;1m");
+	check("red | SGR 0 | italic", dye::red | sgr("\x1b[0m") | dye::italic, "\x1b[0;3m");
+
+	// SGR sequences, whatever their parameters' order and unknown parameters
+	check("SGR 38;2", sgr("\x1b[38;2;1;2;3;4m"), "\x1b[4;38;2;1;2;3m");
+	check("SGR 1;31;44", sgr("\x1b[44;1;31m"), "\x1b[1;31;44m");
+	check("SGR 1;10", sgr("\x1b[10;1m"), "\x1b[1m");
+	check("not SGR", sgr("\x1b[2J"), "");
+
+	// Applied to a rendition, as by StyledStream
+	const size_t bold_red_on_blue[] = { 1, 31, 44 };
+	dye::Rendition expected;
+	expected.apply(bold_red_on_blue, 3);
+	if (!((dye::bold | dye::red | ~dye::blue).applied_to(dye::Rendition()) == expected) && ++failures <= 10)
+		std::cerr << "bold | red | ~blue: wrong rendition\n";
+	if (!(sgr("\x1b[0m").applied_to(expected) == dye::Rendition()) && ++failures <= 10)
+		std::cerr << "SGR 0: wrong rendition\n";
+
+	// Written only to colored streams
+	std::ostringstream colored, plain;
+	colored << dye::always_color << (dye::bold | dye::red | ~dye::blue) << "x";
+	plain << dye::never_color << (dye::bold | dye::red | ~dye::blue) << "x";
+	check("colored", colored.str(), "\x1b[1;31;44mx");
+	check("plain", plain.str(), "x");
+
+	if (failures != 0) {
+		std::cerr << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "Style: ok\n";
+	return 0;
+}
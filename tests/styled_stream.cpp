@@ -0,0 +1,110 @@
+// Writes text and renditions through a StyledStream and compares the bytes
+// reaching the wrapped stream: SGR sequences which would not change the
+// rendition are elided, and the others hold only the parameters needed. Runs
+// of identical characters are written with REP when repeating, across writes
+// but never inside control functions.
+
+#include "../dye.hpp"
+#include <iostream>
+#include <sstream>
+
+namespace {
+	size_t failures = 0;
+
+	std::string escaped(const std::string& s) {
+		std::string out;
+		for (size_t i=0; i<s.size(); ++i)
+			if (s[i] == '\x1b') out += "\\e";
+			else                out += s[i];
+		return out;
+	}
+
+	void check(const char* name, const std::string& actual, const std::string& expected) {
+		if (actual != expected && ++failures <= 10)
+			std::cerr << name << ": \"" << escaped(actual) << "\" instead of \"" << escaped(expected) << "\"\n";
+	}
+
+	std::ostream& repeated(std::ostream& stream) {
+		return stream << dye::always_color << dye::always_repeat;
+	}
+
+	std::ostream& repeated_without_color(std::ostream& stream) {
+		return stream << dye::never_color << dye::always_repeat;
+	}
+
+	std::ostream& not_repeated(std::ostream& stream) {
+		return stream << dye::always_color << dye::never_repeat;
+	}
+
+	// What write writes through a StyledStream on a stream set up by manipulator
+	template <typename F>
+	std::string styled(std::ostream& (*manipulator)(std::ostream&), F write) {
+		std::ostringstream out;
+		out << manipulator;
+		{
+			dye::StyledStream stream(out);
+			write(stream);
+		}
+		return out.str();
+	}
+}
+
+int main() {
+	// Elision
+	check("red(a) red(b)", styled(dye::always_color, [](dye::StyledStream& s) { s << dye::red("a") << dye::red("b"); }),
+	      "\x1b[31mab\x1b[39m");
+	check("red a red b", styled(dye::always_color, [](dye::StyledStream& s) { s << dye::red << "a" << dye::red << "b" << dye::reset; }),
+	      "\x1b[31mab\x1b[39m");
+	check("red(a) c red(b)", styled(dye::always_color, [](dye::StyledStream& s) { s << dye::red("a") << "c" << dye::red("b"); }),
+	      "\x1b[31ma\x1b[39mc\x1b[31mb\x1b[39m");
+	check("no text", styled(dye::always_color, [](dye::StyledStream& s) { s << dye::red << dye::bold << dye::ECMA48::reset; }),
+	      "");
+	check("SGR 31, SGR 31", styled(dye::always_color, [](dye::StyledStream& s) { s << std::string("\x1b[31m") << "a" << std::string("\x1b[31m") << "b" << std::string("\x1b[m"); }),
+	      "\x1b[31mab\x1b[39m");
+
+	// Only the parameters needed
+	check("bold red, red", styled(dye::always_color, [](dye::StyledStream& s) { s << (dye::bold | dye::red) << "a" << dye::ECMA48::reset << dye::red << "b" << dye::ECMA48::reset; }),
+	      "\x1b[1;31ma\x1b[22mb\x1b[39m");
+	check("bold | red | ~blue", styled(dye::always_color, [](dye::StyledStream& s) { s << (dye::bold | dye::red | ~dye::blue) << "x" << dye::ECMA48::reset; }),
+	      "\x1b[1;31;44mx\x1b[0m");
+
+	// Other sequences are written as is, SGR ones only when colored
+	check("CUU", styled(dye::always_color, [](dye::StyledStream& s) { s << dye::red << std::string("\x1b[A") << "x" << dye::reset; }),
+	      "\x1b[31m\x1b[Ax\x1b[39m");
+	check("never_color", styled(dye::never_color, [](dye::StyledStream& s) { s << dye::red("a") << (dye::bold | dye::red) << "b" << dye::reset; }),
+	      "ab");
+
+	// Runs held back across writes, and written before renditions change
+	check("run", styled(repeated, [](dye::StyledStream& s) { s << "aaaa" << "aaaa" << dye::red << "aaaaaaaa" << dye::reset; }),
+	      "a\x1b[7b\x1b[31ma\x1b[7b\x1b[39m");
+	check("short runs", styled(repeated, [](dye::StyledStream& s) { s << "aaa|" << "aaaaaa|" << "\xF0\x9F\x98\x80\xF0\x9F\x98\x80|" << "\xC2\xA9\xC2\xA9\xC2\xA9\xC2\xA9"; }),
+	      "aaa|a\x1b[5b|\xF0\x9F\x98\x80\x1b[b|\xC2\xA9\x1b[3b");
+	check("commit", styled(repeated, [](dye::StyledStream& s) { s << "bbbbbb"; s.commit(); s.stream() << "c"; }),
+	      "b\x1b[5bc");
+
+	// Control functions are written as is, from ESC or a C1 control to the end
+	// of the write, and on while they are unfinished
+	check("ESC", styled(repeated, [](dye::StyledStream& s) { s << "aaaa" << "aaaa\x1b[1111111m" << "aaaaaaaa"; }),
+	      "a\x1b[7b\x1b[1111111ma\x1b[7b");
+	check("C1 CSI", styled(repeated, [](dye::StyledStream& s) { s << "aaaaaaaa\xC2\x9B" "1111111m" << "aaaaaaaa"; }),
+	      "a\x1b[7b\xC2\x9B" "1111111ma\x1b[7b");
+	check("cut CSI", styled(repeated, [](dye::StyledStream& s) { s << "aaaaaaaa\x1b" << "[5555555" << "m" << "aaaaaaaa"; }),
+	      "a\x1b[7b\x1b[5555555ma\x1b[7b");
+	check("cut C1 CSI", styled(repeated, [](dye::StyledStream& s) { s << "\xC2" << "\x9B" << "5555555m" << "aaaaaaaa"; }),
+	      "\xC2\x9B" "5555555ma\x1b[7b");
+	check("cut OSC", styled(repeated, [](dye::StyledStream& s) { s << "\x1b]0;" << "tttttttt" << "\x07" << "tttttttt"; }),
+	      "\x1b]0;tttttttt\x07t\x1b[7b");
+
+	// REP only on colored streams whose policy allows it
+	check("never_color", styled(repeated_without_color, [](dye::StyledStream& s) { s << dye::red << "aaaa" << "aaaa\x1b[1111m"; }),
+	      "aaaaaaaa\x1b[1111m");
+	check("never_repeat", styled(not_repeated, [](dye::StyledStream& s) { s << "aaaaaaaa"; }),
+	      "aaaaaaaa");
+
+	if (failures != 0) {
+		std::cerr << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "StyledStream: ok\n";
+	return 0;
+}
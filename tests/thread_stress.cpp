@@ -0,0 +1,48 @@
+// Streams shared manipulators from several threads at once, each thread to
+// its own stream. Built with -fsanitize=thread by `make test`: a data race
+// in a manipulator fails the test, as does output differing between threads.
+
+#include "../dye.hpp"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+	const size_t THREADS = 8;
+	const size_t ITERATIONS = 20000;
+
+	std::string stream_colors() {
+		std::ostringstream out;
+		out << dye::always_color;
+		for (size_t i=0; i<ITERATIONS; ++i) {
+			const size_t percentage = i % 101;
+			out << dye::red("error") << ' '
+			    << dye::red << "red" << dye::reset << ' '
+			    << (~dye::blue)("on blue") << ' '
+			    << dye::jet100(percentage)("jet") << ' '
+			    << dye::hot100.bg(percentage / 100.0f)("on hot") << ' '
+			    << dye::hot(percentage)("hot") << '\n';
+		}
+		return out.str();
+	}
+}
+
+int main() {
+	// jet100 and hot100 are first used by the threads, racing to build them
+	std::vector<std::string> outputs(THREADS);
+	std::vector<std::thread> threads;
+	for (size_t t=0; t<THREADS; ++t)
+		threads.push_back(std::thread([&outputs, t]() { outputs[t] = stream_colors(); }));
+	for (size_t t=0; t<THREADS; ++t) threads[t].join();
+
+	const std::string expected = stream_colors();
+	for (size_t t=0; t<THREADS; ++t) {
+		if (outputs[t] != expected) {
+			std::cerr << "thread " << t << ": unexpected output\n";
+			return 1;
+		}
+	}
+	std::cout << THREADS << " threads x " << ITERATIONS << " lines: ok\n";
+	return 0;
+}
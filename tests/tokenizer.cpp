@@ -0,0 +1,149 @@
+// Tokenizes a mixed input whole, then split at every one and every two
+// points: the serialized token streams must be the same, with the pieces of
+// control strings joined. The whole stream is checked against the expected
+// token kinds, parameters, markers and intermediates.
+
+#include "../dye.hpp"
+#include <iostream>
+#include <sstream>
+
+namespace {
+	const std::string INPUT =
+		"plain\t\x1b[1;31mred\x1b[m"        // SGR, without parameters
+		"\x1b[?25l"                          // Private marker
+		"\x1b[38:2::10:20:30m"               // Sub-parameters
+		"\x1b[2 q\x1b[;5H"                   // Intermediate byte, omitted parameter
+		"\x1b" "7\x1b(B"                     // Escape sequences
+		"\x1b" "E"                           // C1 control
+		"\x1b]0;title\x07"                   // OSC ended by BEL
+		"\x1bPq#0;2;0;0;0\x1b\\"             // DCS ended by ST
+		"\x1b[12\nx"                         // Control sequence cut short
+		"\x1b_apc\x1b[5A"                    // Control string ended by CSI
+		"\r\n";
+
+	const char* const EXPECTED =
+		"TEXT plain\n"
+		"C0 9\n"
+		"CSI m 1;31\n"
+		"TEXT red\n"
+		"CSI m\n"
+		"CSI l ?25\n"
+		"CSI m 38:2:_:10:20:30\n"
+		"CSI q 2 [ ]\n"
+		"CSI H _;5\n"
+		"ESC 7\n"
+		"ESC B [(]\n"
+		"C1 E\n"
+		"STRING ] 0;title\n"
+		"STRING P q#0;2;0;0;0\n"
+		"INVALID 4\n"
+		"C0 10\n"
+		"TEXT x\n"
+		"STRING _ apc\n"
+		"CSI A 5\n"
+		"C0 13\n"
+		"C0 10\n";
+
+	// Serializes tokens, joining text runs and the pieces of control strings,
+	// which may be split anywhere
+	class Serializer {
+		public:
+			Serializer() : text_(false), is_string_open_(false) {}
+
+			void operator()(const dye::ECMA48::Token& token) {
+				typedef dye::ECMA48::Token Token;
+				if (token.kind != Token::TEXT) end_text();
+				switch (token.kind) {
+					case Token::TEXT:
+						if (!text_) out_ << "TEXT ";
+						text_ = true;
+						out_ << std::string(token.bytes.data(), token.bytes.size());
+						break;
+					case Token::C0_CONTROL:
+						out_ << "C0 " << int(token.function) << "\n";
+						break;
+					case Token::C1_CONTROL:
+						out_ << "C1 " << token.function << "\n";
+						break;
+					case Token::ESCAPE_SEQUENCE:
+						out_ << "ESC " << token.function;
+						intermediates(token);
+						out_ << "\n";
+						break;
+					case Token::CONTROL_SEQUENCE:
+						out_ << "CSI " << token.function;
+						if (token.private_marker != 0 || token.parameter_count != 0) out_ << " ";
+						if (token.private_marker != 0) out_ << token.private_marker;
+						for (size_t i=0; i<token.parameter_count; ++i) {
+							if (i != 0) out_ << (token.subparameters >> i & 1 ? ':' : ';');
+							if (token.omitted >> i & 1) out_ << '_';
+							else out_ << token.parameters[i];
+						}
+						intermediates(token);
+						out_ << "\n";
+						break;
+					case Token::CONTROL_STRING:
+						if (token.is_first != !is_string_open_) out_ << "(is_first " << token.is_first << ")";
+						if (token.is_first) out_ << "STRING " << token.function << " ";
+						is_string_open_ = !token.is_last;
+						out_ << std::string(token.bytes.data(), token.bytes.size());
+						if (token.is_last) out_ << "\n";
+						break;
+					case Token::INVALID:
+						out_ << "INVALID " << token.bytes.size() << "\n";
+						break;
+				}
+			}
+
+			std::string str() {
+				end_text();
+				return out_.str();
+			}
+
+		private:
+			void end_text() {
+				if (text_) out_ << "\n";
+				text_ = false;
+			}
+
+			void intermediates(const dye::ECMA48::Token& token) {
+				if (token.intermediates.size() != 0)
+					out_ << " [" << std::string(token.intermediates.data(), token.intermediates.size()) << "]";
+			}
+
+			std::ostringstream out_;
+			bool text_;
+			bool is_string_open_;
+	};
+
+	// Tokenizes INPUT split at i and j, i <= j
+	std::string tokenize(size_t i, size_t j) {
+		Serializer serializer;
+		dye::ECMA48::Tokenizer tokenizer;
+		tokenizer.feed(INPUT.data(), i, [&serializer](const dye::ECMA48::Token& token) { serializer(token); });
+		tokenizer.feed(INPUT.data() + i, j - i, [&serializer](const dye::ECMA48::Token& token) { serializer(token); });
+		tokenizer.feed(INPUT.data() + j, INPUT.size() - j, [&serializer](const dye::ECMA48::Token& token) { serializer(token); });
+		tokenizer.finish([&serializer](const dye::ECMA48::Token& token) { serializer(token); });
+		return serializer.str();
+	}
+}
+
+int main() {
+	const std::string whole = tokenize(0, 0);
+	if (whole != EXPECTED) {
+		std::cerr << "Tokens of the whole input:\n" << whole;
+		return 1;
+	}
+
+	size_t mismatches = 0;
+	for (size_t i=0; i<=INPUT.size(); ++i)
+		for (size_t j=i; j<=INPUT.size(); ++j)
+			if (tokenize(i, j) != whole && ++mismatches <= 10)
+				std::cerr << "split at " << i << " and " << j << ":\n" << tokenize(i, j);
+	if (mismatches != 0) {
+		std::cerr << mismatches << " mismatches\n";
+		return 1;
+	}
+	std::cout << "Tokenizer: " << INPUT.size() << " bytes split at every 1 and 2 points: ok\n";
+	return 0;
+}
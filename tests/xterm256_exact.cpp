@@ -0,0 +1,27 @@
+// Checks that the integer xterm256::ECMA48_from_rgb() picks the same index as
+// its floating-point definition, reference_ECMA48_from_rgb(), for all 2^24
+// colors.
+
+#include "../dye.hpp"
+#include <iostream>
+
+int main() {
+	size_t mismatches = 0;
+	for (size_t r=0; r<256; ++r)
+		for (size_t g=0; g<256; ++g)
+			for (size_t b=0; b<256; ++b) {
+				const size_t index = dye::xterm256::ECMA48_from_rgb(r, g, b);
+				const size_t expected = dye::xterm256::reference_ECMA48_from_rgb(r, g, b);
+				if (index == expected) continue;
+				if (mismatches++ < 10)
+					std::cerr << "rgb(" << r << "," << g << "," << b << "): " << index
+					          << " instead of " << expected << "\n";
+			}
+
+	if (mismatches != 0) {
+		std::cerr << mismatches << " mismatches\n";
+		return 1;
+	}
+	std::cout << "ECMA48_from_rgb: 16777216 colors: ok\n";
+	return 0;
+}
@@ -0,0 +1,43 @@
+// Checks that xterm256::ECMA48_from_rgb_pixels(), SSE2-accelerated when
+// available, converts all 2^24 colors to the indices of the scalar
+// xterm256::ECMA48_from_rgb(), in batches of every length modulo 8.
+
+#include "../dye.hpp"
+#include <iostream>
+#include <vector>
+
+int main() {
+	const size_t COLORS = 1 << 24;
+	std::vector<uint8_t> rgb(3 * COLORS);
+	for (size_t c=0; c<COLORS; ++c) {
+		rgb[3*c]   = uint8_t(c >> 16);
+		rgb[3*c+1] = uint8_t(c >> 8);
+		rgb[3*c+2] = uint8_t(c);
+	}
+
+	// Batches of 1 to 15 pixels, so that every pixel goes through a vector
+	// lane or the scalar tail
+	std::vector<uint8_t> indices(COLORS);
+	for (size_t c=0, n=1; c<COLORS; c+=n, n=n%15+1)
+		dye::xterm256::ECMA48_from_rgb_pixels(&rgb[3*c], std::min(n, COLORS - c), &indices[c]);
+
+	size_t mismatches = 0;
+	for (size_t c=0; c<COLORS; ++c) {
+		const size_t expected = dye::xterm256::ECMA48_from_rgb(rgb[3*c], rgb[3*c+1], rgb[3*c+2]);
+		if (indices[c] == expected) continue;
+		if (mismatches++ < 10)
+			std::cerr << "rgb(" << int(rgb[3*c]) << "," << int(rgb[3*c+1]) << "," << int(rgb[3*c+2]) << "): "
+			          << int(indices[c]) << " instead of " << expected << "\n";
+	}
+
+	if (mismatches != 0) {
+		std::cerr << mismatches << " mismatches\n";
+		return 1;
+	}
+#ifdef __SSE2__
+	std::cout << "ECMA48_from_rgb_pixels (SSE2): 16777216 colors: ok\n";
+#else
+	std::cout << "ECMA48_from_rgb_pixels (scalar): 16777216 colors: ok\n";
+#endif
+	return 0;
+}